@@ -0,0 +1,81 @@
+#include <TROOT.h>
+#include <TFile.h>
+#include <TNtuple.h>
+#include <TRandom3.h>
+#include <TMath.h>
+#include <TSystem.h>
+
+#include <string>
+#include <fstream>
+#include <iostream>
+#include <limits>
+
+// Synthetic ntp_truthjet files for benchmarking the analysis macros
+// Same schema as the JetEvaluator ntuple.  Truth jets are flat in eta and phi
+// with an exponential energy spectrum, reco jets are smeared copies and
+// nanFraction of the truth jets have no matched reco jet (reco columns NaN).
+// Spectra and smearing are parameters.
+// Writes <outDir>/truthjet_<i>.root and the file list <outDir>/files.list.
+
+// Jets per event, only used for the event column
+const int jetsPerEvent = 4;
+
+// Spectra: eta in [etaMin, etaMax), dN/dE ~ exp(-energySlope E) in
+// [energyMin, energyMax) GeV.  Reco smearing: energyResolution relative,
+// angularResolution absolute in eta and phi.
+void generateTruthJets(std::string outDir = "bench_data", int nFiles = 4, long entriesPerFile = 250000,
+                       double nanFraction = 0.1, int compression = 101, unsigned seed = 12345,
+                       double etaMin = -3.5, double etaMax = 3.5, double energyMin = 1, double energyMax = 80,
+                       double energySlope = 0.1, double energyResolution = 0.1, double angularResolution = 0.05) {
+    gSystem->mkdir(outDir.c_str(), true);
+    std::ofstream fileList(outDir + "/files.list");
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    TRandom3 random(seed);
+    for (int file = 0; file < nFiles; file++) {
+        std::string path = outDir + "/truthjet_" + std::to_string(file) + ".root";
+        TFile *outFile = new TFile(path.c_str(), "RECREATE", "", compression);
+        TNtuple *ntuple = new TNtuple("ntp_truthjet", "truth jet => best reco jet",
+                                      "event:gid:gncomp:geta:gphi:ge:gpt:id:ncomp:eta:phi:e:pt:efromtruth");
+        float row[14];
+        for (long entry = 0; entry < entriesPerFile; entry++) {
+            float geta = random.Uniform(etaMin, etaMax);
+            float gphi = random.Uniform(-TMath::Pi(), TMath::Pi());
+            float ge = energyMin - std::log(1 - random.Rndm() * (1 - std::exp(-energySlope * (energyMax - energyMin)))) / energySlope;
+            row[0] = file * entriesPerFile / jetsPerEvent + entry / jetsPerEvent;
+            row[1] = entry % jetsPerEvent;
+            row[2] = random.Poisson(10);
+            row[3] = geta;
+            row[4] = gphi;
+            row[5] = ge;
+            row[6] = ge / std::cosh(geta);
+            if (random.Rndm() < nanFraction) {
+                for (int i = 7; i < 14; i++) {
+                    row[i] = nan;
+                }
+            } else {
+                float eta = geta + random.Gaus(0, angularResolution);
+                float phi = gphi + random.Gaus(0, angularResolution);
+                if (phi > TMath::Pi()) {
+                    phi -= TMath::TwoPi();
+                }
+                if (phi < -TMath::Pi()) {
+                    phi += TMath::TwoPi();
+                }
+                float e = ge * (1 + random.Gaus(0, energyResolution));
+                row[7] = row[1];
+                row[8] = random.Poisson(row[2]);
+                row[9] = eta;
+                row[10] = phi;
+                row[11] = e;
+                row[12] = e / std::cosh(eta);
+                row[13] = e;
+            }
+            ntuple->Fill(row);
+        }
+        ntuple->Write();
+        Long64_t size = outFile->GetSize();
+        outFile->Close();
+        fileList << path << std::endl;
+        std::cout << "wrote " << entriesPerFile << " jets to " << path << " (" << size / 1e6 << " MB)" << std::endl;
+    }
+}
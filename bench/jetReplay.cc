@@ -0,0 +1,159 @@
+// Replay of JetEnergyResolution without Fun4All
+//
+// Reads a jet event record written by JetEnergyResolution::set_record_file and
+// runs the module's matching and filling (src/JetResolutionCore.h) over it,
+// optionally writing RecoJetTree and ResponseHist like the module does.
+// Events are loaded into memory first so the timing covers only the logic.
+// recoNode, the module's reco jet collection, sets the region branch; the
+// record has no preselection, so weight is 1 and preselected true throughout.
+//
+// usage: jetReplay <record> [output.root] [repeat] [recoNode]
+//        jetReplay --generate <record> [events] [jetsPerEvent]   synthetic record
+
+#include "../src/JetRegions.h"
+#include "../src/JetResolutionCore.h"
+
+#include <TFile.h>
+#include <TTree.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+  // Events that look like the module's input: reco jets are smeared truth
+  // jets, most with an eval match and some left to the dR fallback
+  int Generate(const std::string &path, int nEvents, int jetsPerEvent)
+  {
+    JetEventWriter writer(path);
+    if (!writer.IsOpen())
+    {
+      std::cerr << "Could not open " << path << std::endl;
+      return 1;
+    }
+    std::mt19937 random(12345);
+    std::uniform_real_distribution<float> eta(-3.5, 3.5);
+    std::uniform_real_distribution<float> phi(-JetMatching::kPi, JetMatching::kPi);
+    std::exponential_distribution<float> energy(0.1);
+    std::normal_distribution<float> smear(0, 0.1);
+    std::uniform_real_distribution<float> uniform(0, 1);
+    JetEvent event;
+    for (int i = 0; i < nEvents; i++)
+    {
+      event.Clear();
+      event.id = i;
+      event.jetParameter = 0.4;
+      for (int jet = 0; jet < jetsPerEvent; jet++)
+      {
+        float truthEta = eta(random);
+        float truthE = 1 + energy(random);
+        event.AddTruth(truthE / std::cosh(truthEta), truthE, truthEta, phi(random));
+      }
+      for (int jet = 0; jet < jetsPerEvent; jet++)
+      {
+        float recoEta = event.truthEta[jet] + smear(random) * 0.5f;
+        float recoE = event.truthE[jet] * (1 + smear(random));
+        float recoPhi = JetMatching::WrapPhi(event.truthPhi[jet] + smear(random) * 0.5f);
+        event.AddReco(recoE / std::cosh(recoEta), recoE, recoEta, recoPhi, uniform(random) < 0.8 ? jet : -1);
+      }
+      writer.Write(event);
+    }
+    std::cout << "wrote " << nEvents << " events with " << jetsPerEvent << " jets to " << path << std::endl;
+    return 0;
+  }
+}  // namespace
+
+int main(int argc, char **argv)
+{
+  if (argc < 2)
+  {
+    std::cerr << "usage: jetReplay <record> [output.root] [repeat] [recoNode]" << std::endl;
+    std::cerr << "       jetReplay --generate <record> [events] [jetsPerEvent]" << std::endl;
+    return 1;
+  }
+  if (std::string(argv[1]) == "--generate")
+  {
+    if (argc < 3)
+    {
+      std::cerr << "usage: jetReplay --generate <record> [events] [jetsPerEvent]" << std::endl;
+      return 1;
+    }
+    return Generate(argv[2], argc > 3 ? std::atoi(argv[3]) : 1000000, argc > 4 ? std::atoi(argv[4]) : 4);
+  }
+  std::string outputName = argc > 2 ? argv[2] : "";
+  int repeat = argc > 3 ? std::atoi(argv[3]) : 1;
+  std::string recoNode = argc > 4 ? argv[4] : JetRegions::kCentralTowerJets;
+  bool stitched = JetRegions::IsStitched(recoNode);
+  int collectionRegion = JetRegions::CollectionRegion(recoNode);
+
+  JetEventReader reader(argv[1]);
+  if (!reader.IsOpen())
+  {
+    std::cerr << "Could not read jet event record " << argv[1] << std::endl;
+    return 1;
+  }
+  std::vector<JetEvent> events;
+  uint64_t recoJets = 0;
+  JetEvent event;
+  while (reader.Next(event))
+  {
+    recoJets += event.NReco();
+    events.push_back(event);
+  }
+  if (reader.Damaged())
+  {
+    std::cerr << "Jet event record " << argv[1] << " is damaged after " << events.size() << " events" << std::endl;
+    return 1;
+  }
+  std::cout << "loaded " << events.size() << " events, " << recoJets << " reco jets" << std::endl;
+
+  TFile *outfile = nullptr;
+  TTree *recoJetTree = nullptr;
+  RecoJetRow row;
+  if (outputName != "")
+  {
+    outfile = new TFile(outputName.c_str(), "RECREATE");
+    recoJetTree = JetResolutionCore::BookRecoJetTree(row);
+  }
+
+  FixedHist<JetResponseBinning> responseHist;
+  uint64_t matched = 0;
+  for (int pass = 0; pass < repeat; pass++)
+  {
+    bool fillTree = recoJetTree != nullptr && pass == 0;
+    responseHist.Reset();
+    matched = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (const JetEvent &replayed : events)
+    {
+      JetResolutionCore::MatchEvent(replayed, [&](const MatchedJet &jet) {
+        if (fillTree)
+        {
+          row.SetJet(jet);
+          row.region = stitched ? JetRegions::StitchRegion(jet.recoEta) : collectionRegion;
+          recoJetTree->Fill();
+        }
+        JetResolutionCore::FillResponse(responseHist, jet);
+        matched++;
+      });
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "pass " << pass << ": " << matched << " matched of " << recoJets << " reco jets in " << seconds << " s, "
+              << recoJets / seconds / 1e6 << " M jets/s" << (fillTree ? " (with tree)" : "") << std::endl;
+  }
+
+  if (outfile)
+  {
+    outfile->cd();
+    responseHist.MakeHist("ResponseHist", ";truth energy;(reco - truth) / truth");  // owned by outfile
+    recoJetTree->Write();
+    outfile->Write();
+    outfile->Close();
+    delete outfile;
+  }
+  return 0;
+}
@@ -0,0 +1,252 @@
+// Micro-benchmark of the jet matching kernels in src/JetMatching.h
+//
+//   closest  JetMatching::ClosestMatch, the dR fallback of
+//            JetEnergyResolution::process_event: every reco jet against all
+//            truth jets of its event
+//   table    the same with JetMatching::TableWrap
+//   pair     JetMatching::PairDistance2, calculateDistance in the macros: one
+//            ntuple row [truthEta, truthPhi, recoEta, recoPhi] at a time
+//
+// Events are synthetic, flat in eta and phi, with truth multiplicities from a
+// few jets up to embedded (Au+Au background) events.  Reports ns per jet pair
+// and, where perf events are available, last level cache misses per pair.
+//
+// usage: matchingBenchmark [maxMultiplicity] [pairsPerPoint] [recoPerTruth]
+
+#include "../src/JetMatching.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+  const float etaRange = 3.5;
+  const float matchDR = 0.4;
+
+  // Hardware cache miss counter for this thread, inactive if perf events are not permitted
+  class CacheMissCounter
+  {
+   public:
+    CacheMissCounter()
+    {
+#ifdef __linux__
+      perf_event_attr attr;
+      std::memset(&attr, 0, sizeof(attr));
+      attr.size = sizeof(attr);
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.config = PERF_COUNT_HW_CACHE_MISSES;
+      attr.disabled = 1;
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      fd = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+#endif
+    }
+
+    ~CacheMissCounter()
+    {
+#ifdef __linux__
+      if (fd >= 0)
+      {
+        close(fd);
+      }
+#endif
+    }
+
+    bool Available() const { return fd >= 0; }
+
+    void Start()
+    {
+#ifdef __linux__
+      if (fd >= 0)
+      {
+        ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+      }
+#endif
+    }
+
+    uint64_t Stop()
+    {
+      uint64_t count = 0;
+#ifdef __linux__
+      if (fd >= 0)
+      {
+        ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        if (read(fd, &count, sizeof(count)) != sizeof(count))
+        {
+          count = 0;
+        }
+      }
+#endif
+      return count;
+    }
+
+   private:
+    int fd = -1;
+  };
+
+  // All events of one benchmark point, stored back to back like a run of events
+  struct Events
+  {
+    int nTruth;
+    int nReco;
+    int nEvents;
+    std::vector<float> truthEta, truthPhi;   // nEvents * nTruth
+    std::vector<float> recoEta, recoPhi;     // nEvents * nReco
+    std::vector<float> rows;                 // nEvents * nReco * nTruth * 4, ntuple rows
+  };
+
+  Events MakeEvents(int nTruth, int nReco, int nEvents, std::mt19937 &random)
+  {
+    std::uniform_real_distribution<float> eta(-etaRange, etaRange);
+    std::uniform_real_distribution<float> phi(-JetMatching::kPi, JetMatching::kPi);
+    std::normal_distribution<float> smear(0, 0.1);
+    Events events;
+    events.nTruth = nTruth;
+    events.nReco = nReco;
+    events.nEvents = nEvents;
+    for (int i = 0; i < nEvents * nTruth; i++)
+    {
+      events.truthEta.push_back(eta(random));
+      events.truthPhi.push_back(phi(random));
+    }
+    for (int event = 0; event < nEvents; event++)
+    {
+      for (int i = 0; i < nReco; i++)
+      {
+        // reco jets are smeared truth jets, so most find a match
+        int truth = event * nTruth + i % nTruth;
+        events.recoEta.push_back(events.truthEta[truth] + smear(random));
+        events.recoPhi.push_back(JetMatching::WrapPhi(events.truthPhi[truth] + smear(random)));
+      }
+    }
+    events.rows.reserve(static_cast<std::size_t>(nEvents) * nReco * nTruth * 4);
+    for (int event = 0; event < nEvents; event++)
+    {
+      for (int reco = 0; reco < nReco; reco++)
+      {
+        for (int truth = 0; truth < nTruth; truth++)
+        {
+          events.rows.push_back(events.truthEta[event * nTruth + truth]);
+          events.rows.push_back(events.truthPhi[event * nTruth + truth]);
+          events.rows.push_back(events.recoEta[event * nReco + reco]);
+          events.rows.push_back(events.recoPhi[event * nReco + reco]);
+        }
+      }
+    }
+    return events;
+  }
+
+  struct Result
+  {
+    double nsPerPair;
+    double missesPerPair;
+    double checksum;  // keeps the compiler from dropping the work
+  };
+
+  template <class Kernel>
+  Result Time(Kernel kernel, uint64_t pairs, CacheMissCounter &misses)
+  {
+    kernel();  // warm up
+    misses.Start();
+    auto start = std::chrono::steady_clock::now();
+    double checksum = kernel();
+    auto stop = std::chrono::steady_clock::now();
+    uint64_t missCount = misses.Stop();
+    double ns = std::chrono::duration<double, std::nano>(stop - start).count();
+    return {ns / pairs, double(missCount) / pairs, checksum};
+  }
+
+  template <class Wrap>
+  double RunClosest(const Events &events)
+  {
+    double sum = 0;
+    for (int event = 0; event < events.nEvents; event++)
+    {
+      const float *etas = &events.truthEta[event * events.nTruth];
+      const float *phis = &events.truthPhi[event * events.nTruth];
+      for (int reco = 0; reco < events.nReco; reco++)
+      {
+        float dR;
+        int match = JetMatching::ClosestMatch<Wrap>(events.recoEta[event * events.nReco + reco], events.recoPhi[event * events.nReco + reco],
+                                                    etas, phis, events.nTruth, matchDR, dR);
+        sum += match + dR;
+      }
+    }
+    return sum;
+  }
+
+  double RunPair(Events &events)
+  {
+    double sum = 0;
+    float pos[4];
+    for (std::size_t row = 0; row < events.rows.size(); row += 4)
+    {
+      std::memcpy(pos, &events.rows[row], sizeof(pos));  // the macros read into a local array
+      sum += JetMatching::PairDistance2(pos);
+    }
+    return sum;
+  }
+}  // namespace
+
+int main(int argc, char **argv)
+{
+  int maxMultiplicity = argc > 1 ? std::atoi(argv[1]) : 1024;
+  uint64_t pairsPerPoint = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 20000000;
+  double recoPerTruth = argc > 3 ? std::atof(argv[3]) : 1;
+
+  std::mt19937 random(12345);
+  CacheMissCounter misses;
+  if (!misses.Available())
+  {
+    std::printf("# cache miss counter not available (perf_event_paranoid or container), misses shown as -\n");
+  }
+  std::printf("# kernel    truth  reco   events   pairs/event  ns/pair  misses/pair  footprint[kB]\n");
+  double checksum = 0;
+  for (int nTruth = 1; nTruth <= maxMultiplicity; nTruth *= 2)
+  {
+    int nReco = std::max(1, static_cast<int>(std::lround(nTruth * recoPerTruth)));
+    uint64_t pairsPerEvent = static_cast<uint64_t>(nTruth) * nReco;
+    // cap the ntuple row copy at ~256 MB
+    uint64_t maxEvents = std::max<uint64_t>(1, (256ULL << 20) / (pairsPerEvent * 4 * sizeof(float)));
+    int nEvents = static_cast<int>(std::min(maxEvents, std::max<uint64_t>(1, pairsPerPoint / pairsPerEvent)));
+    Events events = MakeEvents(nTruth, nReco, nEvents, random);
+    uint64_t pairs = pairsPerEvent * nEvents;
+
+    Result closest = Time([&] { return RunClosest<JetMatching::CompareWrap>(events); }, pairs, misses);
+    Result table = Time([&] { return RunClosest<JetMatching::TableWrap>(events); }, pairs, misses);
+    Result pair = Time([&] { return RunPair(events); }, pairs, misses);
+    checksum += closest.checksum + table.checksum + pair.checksum;
+
+    double closestKB = (events.truthEta.size() + events.truthPhi.size() + events.recoEta.size() + events.recoPhi.size()) * sizeof(float) / 1024.;
+    double pairKB = events.rows.size() * sizeof(float) / 1024.;
+    const Result *results[] = {&closest, &table, &pair};
+    const char *names[] = {"closest", "table", "pair"};
+    const double footprints[] = {closestKB, closestKB, pairKB};
+    for (int i = 0; i < 3; i++)
+    {
+      char missText[32] = "-";
+      if (misses.Available())
+      {
+        std::snprintf(missText, sizeof(missText), "%.4f", results[i]->missesPerPair);
+      }
+      std::printf("%-10s %6d %5d %8d %12llu %8.3f %12s %14.0f\n", names[i], nTruth, nReco, nEvents,
+                  static_cast<unsigned long long>(pairsPerEvent), results[i]->nsPerPair, missText, footprints[i]);
+    }
+  }
+  std::printf("# checksum %g\n", checksum);
+  return 0;
+}
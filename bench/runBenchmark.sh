@@ -0,0 +1,93 @@
+#!/bin/bash
+# End to end throughput benchmark of the analysis macros
+#
+# Generates synthetic ntp_truthjet files (once per data directory), runs every
+# macro over them without the partial histogram cache and collects the stage
+# lines they print (see macro/stageTimer.cpp) into results.txt:
+#   macro stage seconds entries bytes entries/s MB/s peakRSS_MB childPeakRSS_MB
+# The RSS columns are high-water marks of the whole run up to the end of the
+# stage, not of the stage alone.
+# The results are compared with baseline.txt; a stage whose entries/s dropped
+# by more than TOLERANCE percent is reported and the script exits with 1.
+#
+# usage: runBenchmark.sh [--update-baseline] [dataDir] [formats]
+#   NFILES, ENTRIES, NAN_FRACTION, TOLERANCE override the defaults, as do the
+#   spectra of the generated jets: ETA_MIN, ETA_MAX, E_MIN, E_MAX, E_SLOPE,
+#   E_RESOLUTION, ANGULAR_RESOLUTION (see generateTruthJets.cpp)
+
+set -e
+
+BENCH_DIR=$(cd "$(dirname "$0")" && pwd)
+MACRO_DIR=$(cd "$BENCH_DIR/../macro" && pwd)
+BASELINE=$BENCH_DIR/baseline.txt
+
+UPDATE=0
+if [ "$1" == "--update-baseline" ]; then
+    UPDATE=1
+    shift
+fi
+DATA_DIR=$(mkdir -p "${1:-$BENCH_DIR/data}" && cd "${1:-$BENCH_DIR/data}" && pwd)
+FORMATS=${2-png}
+NFILES=${NFILES:-4}
+ENTRIES=${ENTRIES:-250000}
+NAN_FRACTION=${NAN_FRACTION:-0.1}
+TOLERANCE=${TOLERANCE:-10}
+ETA_MIN=${ETA_MIN:--3.5}
+ETA_MAX=${ETA_MAX:-3.5}
+E_MIN=${E_MIN:-1}
+E_MAX=${E_MAX:-80}
+E_SLOPE=${E_SLOPE:-0.1}
+E_RESOLUTION=${E_RESOLUTION:-0.1}
+ANGULAR_RESOLUTION=${ANGULAR_RESOLUTION:-0.05}
+
+FILE_LIST=$DATA_DIR/files.list
+if [ ! -f "$FILE_LIST" ]; then
+    root -l -b -q "$BENCH_DIR/generateTruthJets.cpp+(\"$DATA_DIR\", $NFILES, $ENTRIES, $NAN_FRACTION, 101, 12345, \
+        $ETA_MIN, $ETA_MAX, $E_MIN, $E_MAX, $E_SLOPE, $E_RESOLUTION, $ANGULAR_RESOLUTION)"
+fi
+
+# Outputs of the macros (plots, summaries) stay in the work directory
+WORK_DIR=$DATA_DIR/work
+mkdir -p "$WORK_DIR"
+RESULTS=$WORK_DIR/results.txt
+echo "# macro stage seconds entries bytes entries/s MB/s peakRSS_MB childPeakRSS_MB" > "$RESULTS"
+cd "$WORK_DIR"
+for MACRO in jetEfficiency plotJetEnergyScale plotJetAngularResolution; do
+    echo "running $MACRO"
+    root -l -b -q "$MACRO_DIR/$MACRO.cpp+(\"$FILE_LIST\", \"$MACRO_DIR/regions.txt\", \"\", \"$FORMATS\")" > "$MACRO.log" 2>&1 \
+        || { echo "$MACRO failed, see $WORK_DIR/$MACRO.log"; exit 1; }
+    grep "^stage " "$MACRO.log" | cut -d' ' -f2- >> "$RESULTS"
+done
+column -t "$RESULTS"
+
+if [ $UPDATE == 1 ]; then
+    cp "$RESULTS" "$BASELINE"
+    echo "updated $BASELINE"
+    exit 0
+fi
+if [ ! -f "$BASELINE" ]; then
+    echo "no baseline, rerun with --update-baseline to record one"
+    exit 0
+fi
+
+# Compare entries/s of every stage that processes entries with the baseline
+awk -v tolerance="$TOLERANCE" '
+    /^#/ { next }
+    FNR == NR { baseline[$1 " " $2] = $6; next }
+    {
+        key = $1 " " $2
+        if (!(key in baseline) || baseline[key] == 0 || $4 == 0) {
+            next
+        }
+        change = 100 * ($6 - baseline[key]) / baseline[key]
+        printf "%-28s %-9s %12.0f entries/s  %+6.1f%%\n", $1, $2, $6, change
+        if (change < -tolerance) {
+            regressions++
+        }
+    }
+    END {
+        if (regressions > 0) {
+            printf "%d stage(s) slower than baseline by more than %s%%\n", regressions, tolerance
+            exit 1
+        }
+    }' "$BASELINE" "$RESULTS"
@@ -2,6 +2,8 @@
 #define MACRO_FUN4ALLG4EICDETECTOR_C
 
 #include <jetenergyresolution/JetEnergyResolution.h>
+#include <jetenergyresolution/ReadEICCache.h>
+#include <jetenergyresolution/TruthJetPreselection.h>
 
 #include <GlobalVariables.C>
 
@@ -16,6 +18,9 @@
 #include <G4_Production.C>
 #include <G4_User.C>
 
+#include "JetStitching.C"
+#include "PipelinePruning.C"
+
 #include <TROOT.h>
 #include <fun4all/Fun4AllDstOutputManager.h>
 #include <fun4all/Fun4AllOutputManager.h>
@@ -32,7 +37,19 @@ int Fun4All_JetEnergyResolution(
     const string &outputFile = "G4EICDetector.root",
     const string &embed_input_file = "https://www.phenix.bnl.gov/WWW/publish/phnxbld/sPHENIX/files/sPHENIX_G4Hits_sHijing_9-11fm_00000_00010.root",
     const int skip = 0,
-    const string &outdir = ".")
+    const string &outdir = ".",
+    const string &checkpointFile = "",
+    const int checkpointEvents = 1000,
+    const double checkpointMinutes = 30,
+    const bool resume = false,
+    const double resolutionPrecision = 0,
+    const string &aggregatorSocket = "",
+    const double preselectionPtMin = 0,
+    const string &showerMode = "full",
+    const bool prunePipeline = false,
+    const double resolutionMinEnergy = 5,
+    const double resolutionMaxEnergy = 25,
+    const int resolutionMinEntries = 100)
 {
   //---------------
   // Fun4All server
@@ -101,8 +118,10 @@ int Fun4All_JetEnergyResolution(
 
   // And/Or read generated particles from file
 
-  // eic-smear output
-   Input::READEIC = true;
+  // eic-smear output, or its indexed copy made by convertEIC.cpp (*.eicbin)
+  const string eicCacheSuffix = ".eicbin";
+  const bool eicCache = inputFile.size() > eicCacheSuffix.size() && inputFile.compare(inputFile.size() - eicCacheSuffix.size(), eicCacheSuffix.size(), eicCacheSuffix) == 0;
+   Input::READEIC = !eicCache;
   INPUTREADEIC::filename = inputFile;
 
   // HepMC2 files
@@ -211,6 +230,17 @@ int Fun4All_JetEnergyResolution(
   // register all input generators with Fun4All
   InputRegister();
 
+  // The indexed eic-smear copy is read in place of Input::READEIC and starts
+  // at the first event of the job instead of skipping up to it
+  ReadEICCache *eicCacheReader = nullptr;
+  if (eicCache)
+  {
+    eicCacheReader = new ReadEICCache();
+    if (!eicCacheReader->OpenInputFile(inputFile)) return 1;
+    Input::ApplyEICBeamParameter(eicCacheReader);
+    se->registerSubsystem(eicCacheReader);
+  }
+
   // Reads event generators in EIC smear files, which is registered in InputRegister
   if (Input::READEIC)
   {
@@ -218,6 +248,22 @@ int Fun4All_JetEnergyResolution(
     Input::ApplyEICBeamParameter(INPUTGENERATOR::EICFileReader);
   }
 
+  // Skip Geant4 for events without a generator level jet above
+  // preselectionPtMin; must come after the generators and before PHG4Reco
+  if (preselectionPtMin > 0)
+  {
+    // the module only counts selected events, its checkpoints can't be matched to input events
+    if (resume)
+    {
+      cout << "resume can't be combined with the preselection, rerun the job from the start" << endl;
+      return 1;
+    }
+    TruthJetPreselection *preselection = new TruthJetPreselection();
+    preselection->set_pt_min(preselectionPtMin);
+    preselection->set_bookkeeping_file(outdir + "/" + outputFile + "_preselection.root");
+    se->registerSubsystem(preselection);
+  }
+
   // set up production relatedstuff
   //   Enable::PRODUCTION = true;
 
@@ -331,18 +377,36 @@ int Fun4All_JetEnergyResolution(
 
   Enable::PLUGDOOR = true;
 
+  // Calorimeter showers: "full" Geant4, "fast" parametrized (FastCalorimeter),
+  // "validate" both on the same events, compared in <outputFile>_fastshower.root
+  Enable::FASTSHOWER = showerMode == "fast";
+  Enable::FASTSHOWER_VALIDATION = showerMode == "validate";
+  if (Enable::FASTSHOWER)
+  {
+    // no Geant4 hits: FastCalorimeter makes the calibrated towers directly
+    Enable::CEMC_CELL = Enable::CEMC_TOWER = Enable::CEMC_CLUSTER = Enable::CEMC_EVAL = false;
+    Enable::HCALIN_CELL = Enable::HCALIN_TOWER = Enable::HCALIN_CLUSTER = Enable::HCALIN_EVAL = false;
+    Enable::HCALOUT_CELL = Enable::HCALOUT_TOWER = Enable::HCALOUT_CLUSTER = Enable::HCALOUT_EVAL = false;
+    Enable::FEMC_TOWER = Enable::FEMC_CLUSTER = Enable::FEMC_EVAL = false;
+    Enable::FHCAL_TOWER = Enable::FHCAL_CLUSTER = Enable::FHCAL_EVAL = false;
+    Enable::EEMC_TOWER = Enable::EEMC_CLUSTER = Enable::EEMC_EVAL = false;
+  }
+
   // Other options
   Enable::GLOBAL_RECO = true;
   Enable::GLOBAL_FASTSIM = true;
 
-  // Select only one jet reconstruction- they currently use the same
-  // output collections on the node tree!
+  // Central (Jet_Reco) and forward (Jet_FwdRecoSeparate) jets go to separate
+  // nodes; with both, the analysis uses their stitched full acceptance
+  // collection (JetStitching.C)
   Enable::JETS = true;
   Enable::JETS_EVAL = Enable::JETS && true;
 
   Enable::FWDJETS = true;
   Enable::FWDJETS_EVAL = Enable::FWDJETS && true;
 
+  Enable::JETS_STITCHED = Enable::JETS && Enable::FWDJETS;
+
   // new settings using Enable namespace in GlobalVariables.C
   Enable::BLACKHOLE = true;
   //Enable::BLACKHOLE_SAVEHITS = false; // turn off saving of bh hits
@@ -372,6 +436,15 @@ int Fun4All_JetEnergyResolution(
   // default is All:
   // G4P6DECAYER::decayType = EDecayType::kAll;
 
+  JetEnergyResolution *jetEnergyResolution = new JetEnergyResolution();
+  // the jet eval needs the Geant4 calorimeter hits
+  if (Enable::FASTSHOWER) jetEnergyResolution->set_eval_matching(false);
+  if (Enable::JETS_STITCHED) jetEnergyResolution->set_jet_nodes(JetRegions::kStitchedTowerJets, JetRegions::kStitchedTruthJets);
+
+  // Turn off every subsystem whose outputs the jet analysis does not read;
+  // the geometry in front of the calorimeters stays
+  if (prunePipeline) PrunePipeline(jetEnergyResolution->required_nodes());
+
   // Initialize the selected subsystems
   G4Init();
 
@@ -391,6 +464,8 @@ int Fun4All_JetEnergyResolution(
 
   if (Enable::BBC || Enable::BBCFAKE) Bbc_Reco();
 
+  if (Enable::FASTSHOWER || Enable::FASTSHOWER_VALIDATION) FastShower_Reco();
+
   if (Enable::CEMC_CELL) CEMC_Cells();
 
   if (Enable::HCALIN_CELL) HCALInner_Cells();
@@ -454,7 +529,11 @@ int Fun4All_JetEnergyResolution(
 
   if (Enable::JETS) Jet_Reco();
 
-  if (Enable::FWDJETS) Jet_FwdReco();
+  if (Enable::FWDJETS) Jet_FwdRecoSeparate();
+
+  if (Enable::JETS_STITCHED) Jet_Stitch();
+
+  if (Enable::FASTSHOWER_VALIDATION) FastShower_Eval(outdir + "/" + outputFile + "_fastshower.root");
 
   string outputroot = outputFile;
   string remove_this = ".root";
@@ -483,13 +562,28 @@ int Fun4All_JetEnergyResolution(
 
   if (Enable::EEMC_EVAL) EEMC_Eval(outputroot + "_g4eemc_eval.root");
 
-  if (Enable::JETS_EVAL) Jet_Eval(outputroot + "_g4jet_eval.root");
+  if (Enable::JETS_EVAL && !Enable::FASTSHOWER) Jet_Eval(outputroot + "_g4jet_eval.root");
 
-  if (Enable::FWDJETS_EVAL) Jet_FwdEval();
+  if (Enable::FWDJETS_EVAL && !Enable::FASTSHOWER) Jet_FwdEvalSeparate(outputroot + "_g4fwdjet_eval.root");
 
   if (Enable::USER) UserAnalysisInit();
 
-  JetEnergyResolution *jetEnergyResolution = new JetEnergyResolution();
+  // Stop before nEvents once the energy resolution of every truth energy bin in
+  // [resolutionMinEnergy, resolutionMaxEnergy) GeV has resolutionMinEntries jets
+  // and is known to resolutionPrecision.  The defaults suit the 10x100 ep
+  // sample, which has few jets above 25 GeV.
+  if (resolutionPrecision > 0) jetEnergyResolution->set_convergence(resolutionPrecision, resolutionMinEnergy, resolutionMaxEnergy, resolutionMinEntries);
+  // Checkpoint every checkpointEvents events or checkpointMinutes minutes; with
+  // resume a crashed job continues after the events of its last checkpoint,
+  // including the convergence counts
+  int resumedEvents = 0;
+  if (!checkpointFile.empty())
+  {
+    if (resume) resumedEvents = jetEnergyResolution->resume_from_checkpoint(checkpointFile);
+    jetEnergyResolution->set_checkpoint(checkpointFile, checkpointEvents, checkpointMinutes);
+  }
+  // Push the response histogram to a jetAggregator running on this node
+  if (!aggregatorSocket.empty()) jetEnergyResolution->set_aggregator(aggregatorSocket);
   se->registerSubsystem(jetEnergyResolution);
   std::cout << "#*#*#*#*#*#*#*#*#*#*# Registering JetEnergyResolution Subsystem" << std::endl;
 
@@ -539,16 +633,30 @@ int Fun4All_JetEnergyResolution(
     return 0;
   }
   // if we run any of the particle generators and use 0 it'll run forever
-  if (nEvents == 0 && !Input::READHITS && !Input::HEPMC && !Input::READEIC)
+  if (nEvents == 0 && !Input::READHITS && !Input::HEPMC && !Input::READEIC && !eicCache)
   {
     cout << "using 0 for number of events is a bad idea when using particle generators" << endl;
     cout << "it will run forever, so I just return without running anything" << endl;
     return 0;
   }
 
-  se->skip(skip);
-  std::cout << "Starting to run" << std::endl;
-  se->run(nEvents);
+  if (nEvents > 0 && resumedEvents >= nEvents)
+  {
+    cout << "checkpoint " << checkpointFile << " already covers all " << nEvents << " events" << endl;
+  }
+  else
+  {
+    if (eicCacheReader)
+    {
+      eicCacheReader->SetFirstEntry(skip + resumedEvents);
+    }
+    else
+    {
+      se->skip(skip + resumedEvents);
+    }
+    std::cout << "Starting to run" << std::endl;
+    se->run(nEvents > 0 ? nEvents - resumedEvents : nEvents);
+  }
   std::cout << "Done running" << std::endl;
 
   //-----
@@ -0,0 +1,171 @@
+#ifndef BOOTSTRAP_CPP
+#define BOOTSTRAP_CPP
+
+#include <TROOT.h>
+#include <TH1.h>
+#include <TH2I.h>
+#include <TProfile.h>
+
+#include <string>
+#include <vector>
+#include <cmath>
+
+// Poisson bootstrap
+// Every entry is given an integer Poisson(1) weight in each of bootstrapReplicas
+// replicas, all filled in the same pass as the nominal histograms.  Weights come
+// from a counter based generator keyed on (file, entry), so any split of the
+// input across threads, processes or cached partials gives identical replicas.
+//
+// Replica counts are kept in a TH2I with x = replica and y = global bin of the
+// nominal histogram, so they are merged and cached like any other histogram and
+// the replicas of one bin sit next to each other in memory.
+
+const int bootstrapReplicas = 100;
+const uint64_t bootstrapSeed = 0x4a4552u;
+
+// splitmix64 finalizer
+inline uint64_t mixBits(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+// Stable key of a file, combined with the entry number for the generator counter
+uint64_t bootstrapFileKey(const std::string &path) {
+    uint64_t key = bootstrapSeed;
+    for (char c : path) {
+        key = mixBits(key ^ (uint8_t)c);
+    }
+    return key;
+}
+
+class bootstrapWeights {
+    public:
+        std::vector<uint8_t> weights;
+
+        bootstrapWeights(int replicas = bootstrapReplicas) : weights(replicas) {}
+
+        // Poisson(1) cumulative distribution in units of 2^-16
+        void generate(uint64_t fileKey, uint64_t entry) {
+            static const uint32_t cdf[] = {24109, 48219, 60273, 64292, 65296, 65497, 65531, 65535};
+            uint64_t counter = mixBits(fileKey ^ mixBits(entry));
+            uint64_t bits = 0;
+            for (size_t r = 0; r < weights.size(); r++) {
+                if (r % 4 == 0) {           // four 16 bit uniforms per draw
+                    bits = mixBits(counter + r);
+                }
+                uint32_t u = bits & 0xffff;
+                bits >>= 16;
+                uint8_t k = 0;
+                while (k < 8 && u >= cdf[k]) {
+                    k++;
+                }
+                weights[r] = k;
+            }
+        }
+
+        int size() const { return weights.size(); }
+};
+
+// Replica counts of a nominal histogram, booked alongside it
+TH2I *bootstrapCounts(const TH1 *nominal, int replicas = bootstrapReplicas) {
+    int nCells = (nominal->GetNbinsX() + 2) * (nominal->GetNbinsY() + 2);
+    TH2I *counts = new TH2I(Form("%s_bootstrap", nominal->GetName()), "", replicas, 0, replicas, nCells, 0, nCells);
+    return counts;
+}
+
+// Fill helper for a counts histogram made by bootstrapCounts
+class bootstrapHist {
+    public:
+        const TH1 *nominal;
+        TH2I *counts;
+        int replicas;
+
+        bootstrapHist(const TH1 *nominalHist, TH1 *countHist) : nominal(nominalHist), counts((TH2I*) countHist) {
+            replicas = counts->GetNbinsX();
+        }
+
+        void fillCell(int cell, const bootstrapWeights &weights) {
+            int *row = counts->GetArray() + (cell + 1) * (replicas + 2) + 1;
+            for (int r = 0; r < replicas; r++) {
+                row[r] += weights.weights[r];
+            }
+        }
+
+        void Fill(double x, const bootstrapWeights &weights) {
+            fillCell(nominal->GetXaxis()->FindFixBin(x), weights);
+        }
+
+        void Fill(double x, double y, const bootstrapWeights &weights) {
+            int cell = nominal->GetXaxis()->FindFixBin(x) + (nominal->GetNbinsX() + 2) * nominal->GetYaxis()->FindFixBin(y);
+            fillCell(cell, weights);
+        }
+};
+
+// Materialize replica r as a histogram with the nominal binning, caller owns it
+TH1 *bootstrapReplica(const TH1 *nominal, const TH2I *counts, int r) {
+    bool addDirectory = TH1::AddDirectoryStatus();
+    TH1::AddDirectory(false);
+    TH1 *replica = (TH1*) nominal->Clone(Form("%s_replica_%d", nominal->GetName(), r));
+    TH1::AddDirectory(addDirectory);
+    replica->Reset();
+    int replicas = counts->GetNbinsX();
+    int nCells = counts->GetNbinsY();
+    const int *array = counts->GetArray();
+    double entries = 0;
+    for (int cell = 0; cell < nCells; cell++) {
+        int count = array[(cell + 1) * (replicas + 2) + 1 + r];
+        replica->SetBinContent(cell, count);
+        replica->SetBinError(cell, std::sqrt(count));
+        entries += count;
+    }
+    replica->SetEntries(entries);
+    return replica;
+}
+
+// Standard deviation of a bin's value over the replicas
+class bootstrapSpread {
+    public:
+        std::vector<double> sum;
+        std::vector<double> sum2;
+        std::vector<int> n;
+
+        bootstrapSpread(int bins) : sum(bins, 0), sum2(bins, 0), n(bins, 0) {}
+
+        void add(int bin, double value) {
+            if (std::isnan(value)) {
+                return;
+            }
+            sum[bin] += value;
+            sum2[bin] += value * value;
+            n[bin]++;
+        }
+
+        double error(int bin) const {
+            if (n[bin] < 2) {
+                return 0;
+            }
+            double mean = sum[bin] / n[bin];
+            return std::sqrt(std::max(0., (sum2[bin] / n[bin] - mean * mean) * n[bin] / (n[bin] - 1)));
+        }
+};
+
+// Profile mean and RMS of every x bin of a 2D histogram, for each replica
+void bootstrapProfileSpread(const TH1 *nominal, const TH2I *counts, bootstrapSpread &scale, bootstrapSpread &resolution) {
+    for (int replica = 0; replica < counts->GetNbinsX(); replica++) {
+        TH2 *replicaHist = (TH2*) bootstrapReplica(nominal, counts, replica);
+        TProfile *replicaProfile = replicaHist->ProfileX(Form("%s_pfx", replicaHist->GetName()));
+        replicaProfile->BuildOptions(0, 0, "s");
+        for (int i = 1; i <= replicaProfile->GetNbinsX(); i++) {
+            if (replicaProfile->GetBinEntries(i) > 0) {
+                scale.add(i, replicaProfile->GetBinContent(i));
+                resolution.add(i, replicaProfile->GetBinError(i));
+            }
+        }
+        delete replicaProfile;
+        delete replicaHist;
+    }
+}
+
+#endif // BOOTSTRAP_CPP
@@ -0,0 +1,168 @@
+#ifndef COLUMNCACHE_CPP
+#define COLUMNCACHE_CPP
+
+#include <TROOT.h>
+#include <TFile.h>
+#include <TTree.h>
+#include <TLeaf.h>
+#include <TObjArray.h>
+#include <TSystem.h>
+
+#include <string>
+#include <list>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <limits>
+
+#include "common.cpp"
+#include "../src/JetColumnCache.h"
+#include "../src/JetMatching.h"
+
+// Columnar cache
+// columnCache() converts every file of a file list into a memory mapped float32
+// column file (see src/JetColumnCache.h) and writes a file list of the caches,
+// <fileList>.jcol.list, which the macros take in place of the ROOT file list.
+// Repeat analyses then skip decompression and the TTree machinery entirely.
+
+const std::string columnCacheSuffix(".jcol");
+
+// Columns the macros read from a cached ntp_truthjet
+const char *truthJetColumns[] = {"ge", "e", "geta", "gphi", "eta", "phi"};
+
+// Convert every leaf of tree to a float column, returns the number of rows,
+// 0 if nothing usable was written
+Long64_t convertTree(TTree *tree, const std::string &outPath, const std::string &source) {
+    std::vector<TLeaf*> leaves;
+    std::vector<std::string> names;
+    TObjArray *leafList = tree->GetListOfLeaves();
+    for (int i = 0; i < leafList->GetEntries(); i++) {
+        TLeaf *leaf = (TLeaf*) leafList->At(i);
+        if (leaf->GetLen() != 1) {     // arrays don't fit a flat column
+            continue;
+        }
+        leaves.push_back(leaf);
+        names.push_back(leaf->GetName());
+    }
+    if (leaves.empty()) {
+        std::cerr << "No scalar leaves in " << tree->GetName() << " of " << source << std::endl;
+        return 0;
+    }
+    JetColumnWriter writer(outPath, names, source);
+    if (!writer.IsOpen()) {
+        std::cerr << "Could not write " << outPath << std::endl;
+        return 0;
+    }
+    std::vector<float> row(leaves.size());
+    Long64_t nEntries = tree->GetEntries();
+    for (Long64_t i = 0; i < nEntries; i++) {
+        tree->GetEntry(i);
+        for (size_t column = 0; column < leaves.size(); column++) {
+            row[column] = leaves[column]->GetValue();
+        }
+        writer.Fill(row.data());
+    }
+    if (!writer.Close()) {
+        std::cerr << "Could not write " << outPath << std::endl;
+        return 0;
+    }
+    return nEntries;
+}
+
+bool isColumnCache(const std::string &path) {
+    return JetColumnCache::IsCache(path);
+}
+
+// Path of the ROOT file a cache was made from, so bootstrap weights match the original
+std::string columnCacheSource(const std::string &path) {
+    JetColumnFile columns(path);
+    return columns.IsOpen() ? columns.Source() : path;
+}
+
+// Read a cached ntp_truthjet in place.  Calls
+//   fill(entry, truthE, recoE, pos, distance)
+// for every row like the TTree loops of the macros, pos = [geta, gphi, eta, phi]
+// with phi wrap adjusted and distance = PairDistance2(pos) from the batch
+// kernel.  Blocks whose geta range is outside [etaMin, etaMax) are skipped.
+// Returns the number of rows scanned; bytes is increased by the bytes touched.
+template <class Fill>
+uint64_t scanTruthJets(const std::string &path, float etaMin, float etaMax, Fill fill, uint64_t &bytes) {
+    JetColumnFile columns(path);
+    if (!columns.IsOpen()) {
+        std::cerr << "Could not map column cache " << path << std::endl;
+        return 0;
+    }
+    int index[6];
+    for (int i = 0; i < 6; i++) {
+        index[i] = columns.Column(truthJetColumns[i]);
+        if (index[i] < 0) {
+            std::cerr << "Column cache " << path << " has no column " << truthJetColumns[i] << std::endl;
+            return 0;
+        }
+    }
+    uint64_t rows = 0;
+    std::vector<float> distance, wrappedPhi;
+    for (uint64_t block = 0; block < columns.NBlocks(); block++) {
+        const JetColumnCache::ColumnRange &etaRange = columns.Range(block, index[2]);
+        if (etaRange.max < etaMin || etaRange.min >= etaMax) {
+            continue;
+        }
+        uint64_t n = columns.BlockRows(block);
+        const float *truthE = columns.Data(block, index[0]);
+        const float *recoE = columns.Data(block, index[1]);
+        const float *truthEta = columns.Data(block, index[2]);
+        const float *truthPhi = columns.Data(block, index[3]);
+        const float *recoEta = columns.Data(block, index[4]);
+        const float *recoPhi = columns.Data(block, index[5]);
+        distance.resize(n);
+        wrappedPhi.resize(n);
+        JetMatching::PairDistance2Batch(truthEta, truthPhi, recoEta, recoPhi, n, distance.data(), wrappedPhi.data());
+        uint64_t start = columns.BlockStart(block);
+        for (uint64_t i = 0; i < n; i++) {
+            float pos[4] = {truthEta[i], truthPhi[i], recoEta[i], wrappedPhi[i]};
+            fill(start + i, truthE[i], recoE[i], pos, distance[i]);
+        }
+        rows += n;
+        bytes += n * 6 * sizeof(float);
+    }
+    return rows;
+}
+
+// Convert the files of fileList to column caches in outDir (next to each file
+// if empty) and write <fileList>.jcol.list
+void columnCache(std::string fileList, std::string treeName = "ntp_truthjet", std::string outDir = "") {
+    std::list<std::string> files;
+    int nFiles = treeName == catalogTree ? readCatalog(fileList, files) : readFileList(fileList, files);
+    std::cout << "loaded " << nFiles << " files" << std::endl;
+    if (outDir != "") {
+        gSystem->mkdir(outDir.c_str(), true);
+    }
+    std::ofstream cacheList(fileList + columnCacheSuffix + ".list");
+    for (const std::string &path : files) {
+        TFile *inFile = TFile::Open(path.c_str());
+        if (inFile == nullptr) {
+            std::cerr << "Could not open file " << path << std::endl;
+            continue;
+        }
+        TTree *tree = (TTree*) inFile->Get(treeName.c_str());
+        if (tree == nullptr) {
+            std::cerr << "No " << treeName << " in " << path << std::endl;
+            inFile->Close();
+            continue;
+        }
+        size_t slash = path.find_last_of('/');
+        std::string base = slash == std::string::npos ? path : path.substr(slash + 1);
+        std::string dir = outDir != "" ? outDir : slash == std::string::npos ? "." : path.substr(0, slash);
+        std::string outPath = dir + "/" + base + "." + treeName + columnCacheSuffix;
+        Long64_t rows = convertTree(tree, outPath, path);
+        inFile->Close();
+        if (rows <= 0) {
+            std::cerr << "Not listing " << outPath << ", nothing was cached" << std::endl;
+            continue;
+        }
+        cacheList << outPath << std::endl;
+        std::cout << "cached " << rows << " rows of " << path << " in " << outPath << std::endl;
+    }
+}
+
+#endif // COLUMNCACHE_CPP
@@ -5,6 +5,7 @@
 #include <list>
 
 int readFileList(std::string filelist, std::list<std::string> &list);
+int readCatalog(std::string fileList, std::list<std::string> &list);
 float calculateDistance(float *pos);
 
 
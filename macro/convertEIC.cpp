@@ -0,0 +1,78 @@
+#ifndef CONVERTEIC_CPP
+#define CONVERTEIC_CPP
+
+#include <TROOT.h>
+#include <TFile.h>
+#include <TTree.h>
+
+#include <eicsmear/erhic/EventMC.h>
+#include <eicsmear/erhic/ParticleMC.h>
+
+#include <string>
+#include <vector>
+#include <iostream>
+
+#include "../src/EICEventFile.h"
+
+R__LOAD_LIBRARY(libeicsmear.so)
+
+// EIC-smear input cache
+// convertEIC() copies the EICTree of an eic-smear generator file into an
+// indexed event file (src/EICEventFile.h) with the beams and final state
+// particles the Fun4All input uses.  Fun4All_JetEnergyResolution.c reads such
+// files with ReadEICCache, which jumps straight to a shard's first event.
+
+const std::string eicCacheSuffix(".eicbin");
+
+// Returns the number of events written
+Long64_t convertEIC(std::string inputFile, std::string outputFile = "") {
+    if (outputFile == "") {
+        outputFile = inputFile + eicCacheSuffix;
+    }
+    TFile *inFile = TFile::Open(inputFile.c_str());
+    if (inFile == nullptr) {
+        std::cerr << "Could not open file " << inputFile << std::endl;
+        return 0;
+    }
+    TTree *eicTree = (TTree*) inFile->Get("EICTree");
+    if (eicTree == nullptr) {
+        std::cerr << "Could not find EICTree in " << inputFile << std::endl;
+        inFile->Close();
+        return 0;
+    }
+    erhic::EventMC *event = nullptr;
+    eicTree->SetBranchAddress("event", &event);
+
+    EICEventWriter writer(outputFile);
+    if (!writer.IsOpen()) {
+        std::cerr << "Could not write " << outputFile << std::endl;
+        inFile->Close();
+        return 0;
+    }
+    std::vector<EICParticle> particles;
+    Long64_t nEvents = eicTree->GetEntries();
+    for (Long64_t i = 0; i < nEvents; i++) {
+        eicTree->GetEntry(i);
+        particles.clear();
+        for (unsigned track = 0; track < event->GetNTracks(); track++) {
+            const erhic::ParticleMC *particle = event->GetTrack(track);
+            // beams are the first two tracks, everything else only if final state
+            if (track >= 2 && particle->GetStatus() != 1) {
+                continue;
+            }
+            EICParticle converted = {particle->Id().Code(), particle->GetStatus(), (float) particle->GetPx(), (float) particle->GetPy(),
+                                     (float) particle->GetPz(), (float) particle->GetE(), (float) particle->GetM()};
+            particles.push_back(converted);
+        }
+        writer.Write(event->GetN(), particles);
+    }
+    inFile->Close();
+    if (!writer.Close()) {
+        std::cerr << "Could not write " << outputFile << ", removed it" << std::endl;
+        return 0;
+    }
+    std::cout << "converted " << nEvents << " events of " << inputFile << " to " << outputFile << std::endl;
+    return nEvents;
+}
+
+#endif // CONVERTEIC_CPP
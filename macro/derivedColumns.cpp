@@ -0,0 +1,167 @@
+#ifndef DERIVEDCOLUMNS_CPP
+#define DERIVEDCOLUMNS_CPP
+
+#include <TROOT.h>
+#include <TFile.h>
+#include <TTree.h>
+#include <TNamed.h>
+#include <TSystem.h>
+
+#include <string>
+#include <list>
+#include <vector>
+#include <iostream>
+#include <cmath>
+
+#include "common.cpp"
+#include "partialCache.cpp"
+#include "columnCache.cpp"
+
+// Derived columns
+// derivedColumns() computes, once per file of a file list, what the macros
+// derive from the raw ge/e/geta/gphi/eta/phi columns of every ntp_truthjet
+// entry and writes it to <file>.ntp_truthjet.derived.root as the tree
+// "derived", entry by entry aligned with ntp_truthjet:
+//   dR2       truth-reco dR^2 with phi wrapped, JetMatching::kNoMatch if the
+//             reco jet is missing (NaN e, eta or phi) or the truth angles are NaN
+//   region    regionClassifier bitmask of the region config, 0 for NaN truth
+//   response  (e - ge) / ge
+//   dEta      eta - geta
+//   dPhi      phi - gphi wrapped into [-pi, pi]
+// addDerivedColumns() attaches it as a friend if it is current and was made
+// with the same region config.  A matched jet (dR2 accepted) in a region
+// (region != 0) then has finite values throughout, so the macros skip the NaN
+// checks, the region lookup and the phi wrapping.
+
+const std::string derivedColumnsSuffix(".derived.root");
+const char *derivedColumnNames[] = {"dR2", "region", "response", "dEta", "dPhi"};
+
+// Friend of treeName in path, next to the file if derivedDir is empty
+std::string derivedColumnsPath(const std::string &path, const std::string &treeName, const std::string &derivedDir = "") {
+    size_t slash = path.find_last_of('/');
+    std::string base = slash == std::string::npos ? path : path.substr(slash + 1);
+    std::string dir = derivedDir != "" ? derivedDir : slash == std::string::npos ? "." : path.substr(0, slash);
+    return dir + "/" + base + "." + treeName + derivedColumnsSuffix;
+}
+
+// Write the derived columns of ntp_truthjet in path to derivedPath, returns the number of entries
+Long64_t buildDerivedColumns(const std::string &path, const std::string &derivedPath, const regionClassifier &classifier,
+                             const std::string &regionHash) {
+    TFile *inFile = TFile::Open(path.c_str());
+    if (inFile == nullptr) {
+        std::cerr << "Could not open file " << path << std::endl;
+        return 0;
+    }
+    TTree *jetTree = (TTree*) inFile->Get(catalogTree.c_str());
+    if (jetTree == nullptr) {
+        std::cerr << "No " << catalogTree << " in " << path << std::endl;
+        inFile->Close();
+        return 0;
+    }
+    float truthE, recoE;
+    float pos[4];
+    jetTree->SetBranchStatus("*", false);
+    for (const char *column : truthJetColumns) {
+        jetTree->SetBranchStatus(column, true);
+    }
+    jetTree->SetBranchAddress("ge", &truthE);
+    jetTree->SetBranchAddress("e", &recoE);
+    jetTree->SetBranchAddress("geta", &pos[0]);
+    jetTree->SetBranchAddress("gphi", &pos[1]);
+    jetTree->SetBranchAddress("eta", &pos[2]);
+    jetTree->SetBranchAddress("phi", &pos[3]);
+
+    // Via a temporary file, like the partial cache
+    std::string tmpPath = derivedPath + Form(".%d.tmp", gSystem->GetPid());
+    TFile *out = TFile::Open(tmpPath.c_str(), "RECREATE");
+    if (out == nullptr || out->IsZombie()) {
+        std::cerr << "Could not write derived columns " << tmpPath << std::endl;
+        delete out;
+        inFile->Close();
+        return 0;
+    }
+    writeSourceStamp(out, path);
+    TNamed regions("regionHash", regionHash.c_str());
+    out->WriteTObject(&regions);
+    TTree *derived = new TTree("derived", "per entry quantities derived from ntp_truthjet");
+    float distance, response, dEta, dPhi;
+    uint32_t regionMask;
+    derived->Branch("dR2", &distance, "dR2/F");
+    derived->Branch("region", &regionMask, "region/i");
+    derived->Branch("response", &response, "response/F");
+    derived->Branch("dEta", &dEta, "dEta/F");
+    derived->Branch("dPhi", &dPhi, "dPhi/F");
+    Long64_t nEntries = jetTree->GetEntries();
+    for (Long64_t i = 0; i < nEntries; i++) {
+        jetTree->GetEntry(i);
+        distance = std::isnan(recoE) ? JetMatching::kNoMatch : JetMatching::PairDistance2(pos);  // wraps pos[3]
+        regionMask = classifier.classify(pos[0], truthE);
+        response = (recoE - truthE) / truthE;
+        dEta = pos[2] - pos[0];
+        dPhi = pos[3] - pos[1];
+        derived->Fill();
+    }
+    inFile->Close();
+    out->Write();
+    out->Close();
+    delete out;
+    gSystem->Rename(tmpPath.c_str(), derivedPath.c_str());
+    return nEntries;
+}
+
+// Attach the derived columns of path to tree as friend "derived" and read only
+// them and rawColumns from here on.  false, leaving tree unchanged, if there are
+// none or they are out of date or were made for another region config
+// (regionHash = hashString(regionConfigText(regionConfig))).
+bool addDerivedColumns(TTree *tree, const std::string &path, const std::string &regionHash, const std::vector<std::string> &rawColumns,
+                       const std::string &derivedDir = "") {
+    std::string derivedPath = derivedColumnsPath(path, catalogTree, derivedDir);
+    if (gSystem->AccessPathName(derivedPath.c_str())) {     // true if it does NOT exist
+        return false;
+    }
+    TFile *derivedFile = TFile::Open(derivedPath.c_str());
+    if (derivedFile == nullptr || derivedFile->IsZombie()) {
+        delete derivedFile;
+        return false;
+    }
+    TNamed *regions = (TNamed*) derivedFile->Get("regionHash");
+    TTree *derived = (TTree*) derivedFile->Get("derived");
+    bool current = matchesSourceStamp(derivedFile, path) && regions != nullptr && derived != nullptr &&
+                   regions->GetTitle() == regionHash && derived->GetEntries() == tree->GetEntries();
+    derivedFile->Close();
+    delete derivedFile;
+    if (!current) {
+        std::cerr << "Derived columns " << derivedPath << " are out of date, rerun derivedColumns" << std::endl;
+        return false;
+    }
+    tree->AddFriend("derived", derivedPath.c_str());
+    tree->SetBranchStatus("*", false);
+    for (const std::string &column : rawColumns) {
+        tree->SetBranchStatus(column.c_str(), true);
+    }
+    for (const char *column : derivedColumnNames) {
+        tree->SetBranchStatus(column, true);
+    }
+    return true;
+}
+
+// Write the derived columns of every file of fileList for the regions of
+// regionConfig, in derivedDir (next to each file if empty)
+void derivedColumns(std::string fileList, std::string regionConfig = "regions.txt", std::string derivedDir = "") {
+    std::vector<jetData> jets;
+    std::cout << "loaded " << loadRegions(regionConfig, jets) << " regions from " << regionConfig << std::endl;
+    std::list<std::string> files;
+    std::cout << "loaded " << readCatalog(fileList, files) << " files" << std::endl;
+    regionClassifier classifier(jets);
+    std::string regionHash = hashString(regionConfigText(regionConfig));
+    if (derivedDir != "") {
+        gSystem->mkdir(derivedDir.c_str(), true);
+    }
+    for (const std::string &path : files) {
+        std::string derivedPath = derivedColumnsPath(path, catalogTree, derivedDir);
+        Long64_t entries = buildDerivedColumns(path, derivedPath, classifier, regionHash);
+        std::cout << "derived " << entries << " entries of " << path << " in " << derivedPath << std::endl;
+    }
+}
+
+#endif // DERIVEDCOLUMNS_CPP
@@ -0,0 +1,233 @@
+#ifndef ENTRYINDEX_CPP
+#define ENTRYINDEX_CPP
+
+#include <TROOT.h>
+#include <TFile.h>
+#include <TTree.h>
+#include <TBranch.h>
+#include <TEntryList.h>
+#include <TParameter.h>
+#include <TSystem.h>
+
+#include <string>
+#include <list>
+#include <vector>
+#include <algorithm>
+#include <iostream>
+#include <cmath>
+
+#include "common.cpp"
+
+// Truth energy index
+// entryIndex() writes a sidecar <file>.<tree>.idx.root for every file of a file
+// list, holding the entry numbers of the tree ordered by truth energy bucket
+// and, within a bucket, by truth eta.  sliceEntries() looks up a truth energy
+// and eta window in it and returns the matching entries as a TEntryList, so a
+// slice study reads a few baskets instead of scanning the whole tree.  The
+// sidecar records the size and mtime of its file and is ignored once the file
+// changes.  Entries with NaN truth energy or eta are never in a slice and are
+// not indexed.
+
+const std::string entryIndexSuffix(".idx.root");
+const float entryIndexBucketWidth = 1;  // GeV
+const int entryIndexBuckets = 100;      // the last bucket takes everything above
+
+class indexedEntry {
+    public:
+        int bucket;
+        float truthEta;
+        float truthE;
+        Long64_t entry;
+
+        bool operator<(const indexedEntry &other) const {
+            return bucket != other.bucket ? bucket < other.bucket : truthEta < other.truthEta;
+        }
+};
+
+int entryIndexBucket(float truthE, float width, int nBuckets) {
+    if (truthE < 0) {
+        return 0;
+    }
+    if (!(truthE < width * nBuckets)) {
+        return nBuckets - 1;
+    }
+    return (int)(truthE / width);
+}
+
+// Sidecar of treeName in path, next to the file if indexDir is empty
+std::string entryIndexPath(const std::string &path, const std::string &treeName, const std::string &indexDir = "") {
+    size_t slash = path.find_last_of('/');
+    std::string base = slash == std::string::npos ? path : path.substr(slash + 1);
+    std::string dir = indexDir != "" ? indexDir : slash == std::string::npos ? "." : path.substr(0, slash);
+    return dir + "/" + base + "." + treeName + entryIndexSuffix;
+}
+
+// Write the index of treeName in path to indexPath, returns the number of indexed entries
+Long64_t buildEntryIndex(const std::string &path, const std::string &indexPath, const std::string &treeName = "ntp_truthjet") {
+    TFile *inFile = TFile::Open(path.c_str());
+    if (inFile == nullptr) {
+        std::cerr << "Could not open file " << path << std::endl;
+        return 0;
+    }
+    TTree *tree = (TTree*) inFile->Get(treeName.c_str());
+    if (tree == nullptr) {
+        std::cerr << "No " << treeName << " in " << path << std::endl;
+        inFile->Close();
+        return 0;
+    }
+    // Only the two keys are read
+    float truthE, truthEta;
+    tree->SetBranchStatus("*", false);
+    tree->SetBranchStatus("ge", true);
+    tree->SetBranchStatus("geta", true);
+    tree->SetBranchAddress("ge", &truthE);
+    tree->SetBranchAddress("geta", &truthEta);
+    std::vector<indexedEntry> entries;
+    Long64_t nEntries = tree->GetEntries();
+    entries.reserve(nEntries);
+    for (Long64_t i = 0; i < nEntries; i++) {
+        tree->GetEntry(i);
+        if (std::isnan(truthE) || std::isnan(truthEta)) {
+            continue;
+        }
+        entries.push_back({entryIndexBucket(truthE, entryIndexBucketWidth, entryIndexBuckets), truthEta, truthE, i});
+    }
+    inFile->Close();
+    std::stable_sort(entries.begin(), entries.end());
+
+    // Via a temporary file, like the partial cache
+    std::string tmpPath = indexPath + Form(".%d.tmp", gSystem->GetPid());
+    TFile *out = TFile::Open(tmpPath.c_str(), "RECREATE");
+    if (out == nullptr || out->IsZombie()) {
+        std::cerr << "Could not write index " << tmpPath << std::endl;
+        delete out;
+        return 0;
+    }
+    writeSourceStamp(out, path);
+    TParameter<float> bucketWidth("bucketWidth", entryIndexBucketWidth);
+    out->WriteTObject(&bucketWidth);
+
+    // First index row of every bucket, and one past the last row
+    TTree *buckets = new TTree("buckets", "first index row of each truth energy bucket");
+    Long64_t start = 0;
+    buckets->Branch("start", &start, "start/L");
+    size_t row = 0;
+    for (int bucket = 0; bucket <= entryIndexBuckets; bucket++) {
+        while (row < entries.size() && entries[row].bucket < bucket) {
+            row++;
+        }
+        start = row;
+        buckets->Fill();
+    }
+    TTree *index = new TTree("entryIndex", "entries by truth energy bucket and truth eta");
+    indexedEntry current;
+    index->Branch("entry", &current.entry, "entry/L");
+    index->Branch("ge", &current.truthE, "ge/F");
+    index->Branch("geta", &current.truthEta, "geta/F");
+    for (const indexedEntry &entry : entries) {
+        current = entry;
+        index->Fill();
+    }
+    out->Write();
+    out->Close();
+    delete out;
+    gSystem->Rename(tmpPath.c_str(), indexPath.c_str());
+    return entries.size();
+}
+
+// Entries of treeName in path with truth energy in [eMin, eMax) and truth eta
+// in [etaMin, etaMax), in increasing order.  nullptr if there is no index for
+// the current file, the caller then has to scan the tree.
+TEntryList *sliceEntries(const std::string &path, float eMin, float eMax, float etaMin, float etaMax,
+                         const std::string &treeName = "ntp_truthjet", const std::string &indexDir = "") {
+    std::string indexPath = entryIndexPath(path, treeName, indexDir);
+    if (gSystem->AccessPathName(indexPath.c_str())) {   // true if it does NOT exist
+        return nullptr;
+    }
+    TFile *indexFile = TFile::Open(indexPath.c_str());
+    if (indexFile == nullptr || indexFile->IsZombie()) {
+        delete indexFile;
+        return nullptr;
+    }
+    TParameter<float> *bucketWidth = (TParameter<float>*) indexFile->Get("bucketWidth");
+    TTree *buckets = (TTree*) indexFile->Get("buckets");
+    TTree *index = (TTree*) indexFile->Get("entryIndex");
+    if (!matchesSourceStamp(indexFile, path) || bucketWidth == nullptr || buckets == nullptr || index == nullptr) {
+        std::cerr << "Index " << indexPath << " is out of date, rerun entryIndex" << std::endl;
+        indexFile->Close();
+        delete indexFile;
+        return nullptr;
+    }
+    std::vector<Long64_t> bucketStart(buckets->GetEntries());
+    Long64_t start;
+    buckets->SetBranchAddress("start", &start);
+    for (Long64_t i = 0; i < buckets->GetEntries(); i++) {
+        buckets->GetEntry(i);
+        bucketStart[i] = start;
+    }
+    int nBuckets = bucketStart.size() - 1;
+
+    Long64_t entry;
+    float truthE, truthEta;
+    TBranch *etaBranch = nullptr;
+    index->SetBranchAddress("entry", &entry);
+    index->SetBranchAddress("ge", &truthE);
+    index->SetBranchAddress("geta", &truthEta, &etaBranch);
+    std::vector<Long64_t> selected;
+    int firstBucket = entryIndexBucket(eMin, bucketWidth->GetVal(), nBuckets);
+    int lastBucket = entryIndexBucket(eMax, bucketWidth->GetVal(), nBuckets);
+    if (lastBucket > firstBucket && lastBucket < nBuckets - 1 && lastBucket * bucketWidth->GetVal() >= eMax) {
+        lastBucket--;   // eMax on a bucket edge
+    }
+    for (int bucket = firstBucket; bucket <= lastBucket && eMin < eMax; bucket++) {
+        // First row with truth eta >= etaMin, reading only the eta branch
+        Long64_t low = bucketStart[bucket];
+        Long64_t high = bucketStart[bucket + 1];
+        while (low < high) {
+            Long64_t middle = low + (high - low) / 2;
+            etaBranch->GetEntry(middle);
+            if (truthEta < etaMin) {
+                low = middle + 1;
+            }
+            else {
+                high = middle;
+            }
+        }
+        for (Long64_t row = low; row < bucketStart[bucket + 1]; row++) {
+            index->GetEntry(row);
+            if (truthEta >= etaMax) {
+                break;
+            }
+            if (truthE >= eMin && truthE < eMax) {
+                selected.push_back(entry);
+            }
+        }
+    }
+    indexFile->Close();
+    delete indexFile;
+
+    // In entry order, so the tree is read front to back
+    std::sort(selected.begin(), selected.end());
+    TEntryList *list = new TEntryList(Form("slice_%g_%g", eMin, eMax), "", treeName.c_str(), path.c_str());
+    for (Long64_t selectedEntry : selected) {
+        list->Enter(selectedEntry);
+    }
+    return list;
+}
+
+// Index treeName of every file of fileList, in indexDir (next to each file if empty)
+void entryIndex(std::string fileList, std::string treeName = "ntp_truthjet", std::string indexDir = "") {
+    std::list<std::string> files;
+    int nFiles = treeName == catalogTree ? readCatalog(fileList, files) : readFileList(fileList, files);
+    std::cout << "loaded " << nFiles << " files" << std::endl;
+    if (indexDir != "") {
+        gSystem->mkdir(indexDir.c_str(), true);
+    }
+    for (const std::string &path : files) {
+        std::string indexPath = entryIndexPath(path, treeName, indexDir);
+        Long64_t entries = buildEntryIndex(path, indexPath, treeName);
+        std::cout << "indexed " << entries << " entries of " << path << " in " << indexPath << std::endl;
+    }
+}
+
+#endif // ENTRYINDEX_CPP
@@ -0,0 +1,300 @@
+#ifndef FILECATALOG_CPP
+#define FILECATALOG_CPP
+
+#include <TROOT.h>
+#include <TFile.h>
+#include <TTree.h>
+#include <TKey.h>
+#include <TList.h>
+#include <TParameter.h>
+#include <TSystem.h>
+
+#include <string>
+#include <list>
+#include <vector>
+#include <map>
+#include <set>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+#include <stdexcept>
+
+#include "../src/JetColumnCache.h"
+
+// File catalog
+// Every file in a file list is validated once and the result is cached in a
+// sidecar index next to the list (<fileList>.catalog).  As long as a file's size
+// and modification time don't change it is never opened again just to find out
+// it is missing, a zombie or doesn't contain the jet tree.
+
+const std::string catalogVersion("# jet-catalog v1");
+const std::string catalogTree("ntp_truthjet");
+
+class catalogEntry {
+    public:
+        std::string path;
+        std::string status = "missing";    // ok, missing, zombie, notree
+        Long64_t size = -1;
+        long mtime = 0;
+        uint32_t checksum = 0;              // adler32 of the full file
+        Long64_t entries = 0;               // entries in catalogTree
+        std::string trees;                  // comma separated TTree keys
+
+        bool good() const { return status == "ok"; }
+};
+
+// Adler-32 of a whole file, read in 1 MB chunks.  Returns 0 if the file can't be read
+uint32_t fileChecksum(const std::string &path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        return 0;
+    }
+    const uint32_t mod = 65521;
+    uint32_t a = 1, b = 0;
+    std::vector<char> buffer(1 << 20);
+    while (in) {
+        in.read(buffer.data(), buffer.size());
+        std::streamsize n = in.gcount();
+        for (std::streamsize i = 0; i < n; i++) {
+            a = (a + (uint8_t)buffer[i]) % mod;
+            b = (b + a) % mod;
+        }
+    }
+    return (b << 16) | a;
+}
+
+// Fill size and mtime, returns false if the file doesn't exist
+bool statCatalogEntry(catalogEntry &entry) {
+    FileStat_t stat;
+    if (gSystem->GetPathInfo(entry.path.c_str(), stat) != 0) {
+        entry.size = -1;
+        entry.mtime = 0;
+        return false;
+    }
+    entry.size = stat.fSize;
+    entry.mtime = stat.fMtime;
+    return true;
+}
+
+// Sidecars made from a file (entry index, derived columns) record its size and
+// mtime and are only used while both are unchanged
+void writeSourceStamp(TDirectory *sidecar, const std::string &sourcePath) {
+    catalogEntry source;
+    source.path = sourcePath;
+    statCatalogEntry(source);
+    TParameter<Long64_t> sourceSize("sourceSize", source.size);
+    TParameter<Long64_t> sourceMtime("sourceMtime", source.mtime);
+    sidecar->WriteTObject(&sourceSize);
+    sidecar->WriteTObject(&sourceMtime);
+}
+
+bool matchesSourceStamp(TDirectory *sidecar, const std::string &sourcePath) {
+    catalogEntry source;
+    source.path = sourcePath;
+    if (!statCatalogEntry(source)) {
+        return false;
+    }
+    TParameter<Long64_t> *sourceSize = (TParameter<Long64_t>*) sidecar->Get("sourceSize");
+    TParameter<Long64_t> *sourceMtime = (TParameter<Long64_t>*) sidecar->Get("sourceMtime");
+    return sourceSize != nullptr && sourceMtime != nullptr && sourceSize->GetVal() == source.size && sourceMtime->GetVal() == source.mtime;
+}
+
+// Open the file and record what is inside of it
+void validateCatalogEntry(catalogEntry &entry) {
+    entry.entries = 0;
+    entry.trees = "";
+    entry.checksum = 0;
+    if (!statCatalogEntry(entry)) {
+        entry.status = "missing";
+        return;
+    }
+    if (JetColumnCache::IsCache(entry.path)) {   // columnar cache of the jet tree
+        JetColumnFile columns(entry.path);
+        entry.status = !columns.IsOpen() ? "zombie" : columns.Column("geta") < 0 ? "notree" : "ok";
+        entry.entries = columns.IsOpen() ? columns.NRows() : 0;
+        entry.trees = "columns";
+        entry.checksum = fileChecksum(entry.path);
+        return;
+    }
+    TFile *inFile = TFile::Open(entry.path.c_str());
+    if (inFile == nullptr || inFile->IsZombie()) {
+        entry.status = "zombie";
+        delete inFile;
+        return;
+    }
+    std::set<std::string> treeNames;   // keys repeat for every cycle
+    TList *keys = inFile->GetListOfKeys();
+    for (int i = 0; keys != nullptr && i < keys->GetSize(); i++) {
+        TKey *key = (TKey*) keys->At(i);
+        if (std::string(key->GetClassName()) != "TTree" || !treeNames.insert(key->GetName()).second) {
+            continue;
+        }
+        entry.trees += (entry.trees.empty() ? "" : ",") + std::string(key->GetName());
+    }
+    TTree *jetTree = (TTree*) inFile->Get(catalogTree.c_str());
+    if (jetTree == nullptr) {
+        entry.status = "notree";
+    }
+    else {
+        entry.status = "ok";
+        entry.entries = jetTree->GetEntries();
+    }
+    inFile->Close();
+    delete inFile;
+    entry.checksum = fileChecksum(entry.path);
+}
+
+std::string catalogPath(const std::string &fileList) {
+    return fileList + ".catalog";
+}
+
+// Sidecar format: a version line, then one tab separated line per file
+// path status size mtime checksum entries trees
+void readCatalogIndex(const std::string &fileList, std::map<std::string, catalogEntry> &index) {
+    std::ifstream in(catalogPath(fileList));
+    std::string line;
+    if (!std::getline(in, line) || line != catalogVersion) {
+        return;
+    }
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        catalogEntry entry;
+        std::string size, mtime, checksum, entries;
+        std::getline(fields, entry.path, '\t');
+        std::getline(fields, entry.status, '\t');
+        std::getline(fields, size, '\t');
+        std::getline(fields, mtime, '\t');
+        std::getline(fields, checksum, '\t');
+        std::getline(fields, entries, '\t');
+        std::getline(fields, entry.trees, '\t');
+        if (entry.path.empty() || entries.empty()) {
+            continue;
+        }
+        // A corrupt row is left out, so the file is validated again
+        try {
+            entry.size = std::stoll(size);
+            entry.mtime = std::stol(mtime);
+            entry.checksum = std::stoul(checksum);
+            entry.entries = std::stoll(entries);
+        }
+        catch (const std::exception &) {
+            std::cerr << "Ignoring corrupt catalog line for " << entry.path << std::endl;
+            continue;
+        }
+        index[entry.path] = entry;
+    }
+}
+
+void writeCatalogIndex(const std::string &fileList, const std::vector<catalogEntry> &catalog) {
+    std::ofstream out(catalogPath(fileList));
+    if (!out) {
+        std::cerr << "Could not write catalog " << catalogPath(fileList) << std::endl;
+        return;
+    }
+    out << catalogVersion << "\n";
+    for (const catalogEntry &entry : catalog) {
+        out << entry.path << "\t" << entry.status << "\t" << entry.size << "\t" << entry.mtime << "\t"
+            << entry.checksum << "\t" << entry.entries << "\t" << entry.trees << "\n";
+    }
+}
+
+// Build the catalog of a file list, only (re)validating files which are new or changed
+// returns the number of good files
+int loadCatalog(std::string fileList, std::vector<catalogEntry> &catalog) {
+    std::map<std::string, catalogEntry> index;
+    readCatalogIndex(fileList, index);
+
+    std::ifstream files(fileList);
+    std::string filePath;
+    int numGood = 0;
+    bool changed = false;
+    while (std::getline(files, filePath)) {
+        if (filePath.empty()) {
+            continue;
+        }
+        catalogEntry entry;
+        entry.path = filePath;
+        statCatalogEntry(entry);
+        std::map<std::string, catalogEntry>::iterator cached = index.find(filePath);
+        if (cached != index.end() && cached->second.size == entry.size && cached->second.mtime == entry.mtime) {
+            entry = cached->second;
+        }
+        else {
+            validateCatalogEntry(entry);
+            changed = true;
+        }
+        if (entry.good()) {
+            numGood++;
+        }
+        else {
+            std::cerr << "Skipping " << entry.status << " file " << entry.path << std::endl;
+        }
+        catalog.push_back(entry);
+    }
+    files.close();
+    if (changed || catalog.size() != index.size()) {
+        writeCatalogIndex(fileList, catalog);
+    }
+    return numGood;
+}
+
+// Like readFileList, but only returns files the catalog knows to be good
+int readCatalog(std::string fileList, std::list<std::string> &list) {
+    std::vector<catalogEntry> catalog;
+    loadCatalog(fileList, catalog);
+    int numFiles = 0;
+    for (const catalogEntry &entry : catalog) {
+        if (entry.good()) {
+            list.push_back(entry.path);
+            numFiles++;
+        }
+    }
+    return numFiles;
+}
+
+// Split the good files into nShards lists with roughly equal numbers of entries.
+// Largest files are placed first, each into the currently lightest shard
+void shardCatalog(const std::vector<catalogEntry> &catalog, int nShards, std::vector<std::list<std::string>> &shards) {
+    shards.assign(nShards, std::list<std::string>());
+    std::vector<Long64_t> load(nShards, 0);
+    std::vector<const catalogEntry*> sorted;
+    for (const catalogEntry &entry : catalog) {
+        if (entry.good()) {
+            sorted.push_back(&entry);
+        }
+    }
+    std::stable_sort(sorted.begin(), sorted.end(), [](const catalogEntry *a, const catalogEntry *b) {
+        return a->entries > b->entries;
+    });
+    for (const catalogEntry *entry : sorted) {
+        int lightest = std::min_element(load.begin(), load.end()) - load.begin();
+        shards[lightest].push_back(entry->path);
+        load[lightest] += entry->entries;
+    }
+}
+
+// Catalog a file list and, optionally, write balanced shard lists <fileList>.shard<i>
+void fileCatalog(std::string fileList, int nShards = 0) {
+    std::vector<catalogEntry> catalog;
+    int numGood = loadCatalog(fileList, catalog);
+    Long64_t entries = 0;
+    for (const catalogEntry &entry : catalog) {
+        entries += entry.entries;
+    }
+    std::cout << numGood << " of " << catalog.size() << " files good, " << entries << " entries" << std::endl;
+    if (nShards <= 0) {
+        return;
+    }
+    std::vector<std::list<std::string>> shards;
+    shardCatalog(catalog, nShards, shards);
+    for (int i = 0; i < nShards; i++) {
+        std::ofstream out(fileList + ".shard" + std::to_string(i));
+        for (const std::string &path : shards[i]) {
+            out << path << "\n";
+        }
+    }
+    std::cout << "wrote " << nShards << " shard lists" << std::endl;
+}
+
+#endif // FILECATALOG_CPP
@@ -6,6 +6,8 @@
 #include <TCanvas.h>
 #include <TStyle.h>
 #include <TGraph.h>
+#include <TGraphErrors.h>
+#include <TH2I.h>
 #include <THStack.h>
 #include <TLegend.h>
 #include <TMultiGraph.h>
@@ -14,19 +16,29 @@
 #include <string>
 #include <iostream>
 #include <fstream>
+#include <vector>
 
 #include "common.cpp"
+#include "partialCache.cpp"
+#include "bootstrap.cpp"
+#include "render.cpp"
+#include "summary.cpp"
+#include "stageTimer.cpp"
+#include "columnCache.cpp"
+#include "derivedColumns.cpp"
+#include "../src/FixedHistogram.h"
 
 // Binning
 const int num_bins = 50;
 const int min_energy = 0;
 const int max_energy = 50;
+typedef Binning1D<UniformAxis<num_bins, min_energy, max_energy>> energyBinning;
 
 // Cuts
 const float r = 0.5;
 
 // Shouldn't need to touch these
-const float r2 = r * r;
+const JetMatching::DeltaRCut<JetMatching::TableWrap> matching(r);
 
 
 class jetEfficiencyData: public jetData {
@@ -34,57 +46,96 @@ class jetEfficiencyData: public jetData {
         uint32_t fullBins;
         TH1F *truthEnergy;
         TH1F *matchedEnergy;
+        TH2I *truthBootstrap;
+        TH2I *matchedBootstrap;
         float *energy;
         float *efficiency;
-        TGraph *efficiencyGraph;
+        float *efficiencyError;
+        TGraphErrors *efficiencyGraph = nullptr;
 };
 
-void jetEfficiency(std::string centralFileList = "", std::string forwardFileList = "", std::string backwardFileList = "") {
-    // Load files
-    jetEfficiencyData jets[NUM_REGIONS];
-    if (centralFileList != "") {
-        jets[CENTRAL].loaded = true;
-        jets[CENTRAL].descriptiveName = std::string("Central");
-        std::cout << "loaded " << readFileList(centralFileList, jets[CENTRAL].files) << " files in central region" << std::endl;
-        jets[CENTRAL].minEta = -1.5;
-        jets[CENTRAL].maxEta = 1.5;
-        jets[CENTRAL].color = kRed;
-        jets[CENTRAL].secondaryColor = kMagenta;
-        jets[CENTRAL].marker = 21;
-        jets[CENTRAL].markerSize = 1;
-    }
-    if (forwardFileList != "") {
-        jets[FORWARD].loaded = true;
-        jets[FORWARD].descriptiveName = std::string("Forward");
-        std::cout << "loaded " << readFileList(forwardFileList, jets[FORWARD].files) << " files in forward region" << std::endl;
-        jets[FORWARD].minEta = 1.5;
-        jets[FORWARD].maxEta = 3;
-        jets[FORWARD].color = kBlue;
-        jets[FORWARD].secondaryColor = kCyan;
-        jets[FORWARD].marker = 22;
-        jets[FORWARD].markerSize = 1.4;
-    }
-    if (backwardFileList != "") {
-        jets[BACKWARD].loaded = true;
-        jets[BACKWARD].descriptiveName = std::string("Backward");
-        std::cout << "loaded " << readFileList(backwardFileList, jets[BACKWARD].files) << " files in backward region" << std::endl;
-        jets[BACKWARD].minEta = 1.5;    // THESE VALUES ARE NOT SET
-        jets[BACKWARD].maxEta = 3;
-        jets[BACKWARD].color = kGreen + 2;
-        jets[BACKWARD].secondaryColor = kYellow + 1;
-        jets[BACKWARD].marker = 23;
-        jets[BACKWARD].markerSize = 1.4;
+void jetEfficiency(std::string fileList, std::string regionConfig = "regions.txt", std::string cacheDir = "", std::string formats = defaultFormats,
+                   std::string summaryFile = "jetEfficiency.csv", std::string derivedDir = "") {
+    // Load regions and files
+    std::vector<jetEfficiencyData> jets;
+    std::cout << "loaded " << loadRegions(regionConfig, jets) << " regions from " << regionConfig << std::endl;
+    std::list<std::string> files;
+    std::cout << "loaded " << readCatalog(fileList, files) << " files" << std::endl;
+    regionClassifier classifier(jets);
+
+    // 1D histograms to store number of truth jets and reco jets for each energy bin
+    // All regions are filled in one read of each file, and cached together per file
+    partialCache cache(cacheDir, std::string(Form("jetEfficiency %d %d %d %f %d %llu\n", num_bins, min_energy, max_energy, r,
+                                                  bootstrapReplicas, (unsigned long long)bootstrapSeed)) + regionConfigText(regionConfig));
+    summaryWriter summary(summaryFile, "jetEfficiency", cache.configHash);
+    partialHistograms partial;
+    std::vector<TH1*> truthEnergy, matchedEnergy;
+    std::vector<bootstrapHist> truthBootstrap, matchedBootstrap;
+    std::vector<FixedHist<energyBinning>> truthEnergyFill(jets.size());
+    std::vector<FixedHist<energyBinning>> matchedEnergyFill(jets.size());
+    for (jetEfficiencyData &jet : jets) {
+        jet.truthEnergy = new TH1F(Form("truth_energy_%s", jet.descriptiveName.c_str()), "", num_bins, min_energy, max_energy);
+        jet.matchedEnergy  = new TH1F(Form("reco_energy_%s", jet.descriptiveName.c_str()),  "", num_bins, min_energy, max_energy);
+        jet.truthBootstrap = bootstrapCounts(jet.truthEnergy);
+        jet.matchedBootstrap = bootstrapCounts(jet.matchedEnergy);
+        truthEnergy.push_back(partial.add(jet.truthEnergy));
+        matchedEnergy.push_back(partial.add(jet.matchedEnergy));
+        truthBootstrap.push_back(bootstrapHist(jet.truthEnergy, partial.add(jet.truthBootstrap)));
+        matchedBootstrap.push_back(bootstrapHist(jet.matchedEnergy, partial.add(jet.matchedBootstrap)));
     }
+    bootstrapWeights weights;
 
+    // Fill the regions of regionMask with a truth jet
+    uint64_t fileKey = 0;
+    auto fillTruth = [&](uint64_t entry, float truthE, uint32_t regionMask, bool matched) {
+        int energyBin = energyBinning::Cell(truthE);
+        weights.generate(fileKey, entry);
+        for (uint32_t jetRegion = 0; regionMask != 0; jetRegion++, regionMask >>= 1) {
+            if (!(regionMask & 1)) {
+                continue;
+            }
+            truthEnergyFill[jetRegion].Fill(truthE);
+            truthBootstrap[jetRegion].fillCell(energyBin, weights);
+            if (matched) {
+                matchedEnergyFill[jetRegion].Fill(truthE);
+                matchedBootstrap[jetRegion].fillCell(energyBin, weights);
+            }
+        }
+    };
+
+    // Fill every region this jet falls in, distance = matching.Distance2(pos)
+    auto fillEntry = [&](uint64_t entry, float truthE, float recoE, float *pos, float distance) {
+        // Regions this jet falls in, nothing for NaN truth
+        uint32_t regionMask = classifier.classify(pos[0], truthE);
+        if (regionMask == 0) {
+            return;
+        }
+        // Do we filter on R for efficiency? Probably
+        fillTruth(entry, truthE, regionMask, !std::isnan(recoE) && matching.Accept(distance));
+        // std::cout << truthE << "\t" << recoE << std::endl;
+        // std::cout << pos[0] << "\t" << pos[1] << std::endl;
+    };
+    std::string regionHash = hashString(regionConfigText(regionConfig));
+
+    stageTimer timer("jetEfficiency");
+    timer.start("read");
     // Loop over all the files
-    for (uint8_t jetRegion = 0; jetRegion < NUM_REGIONS; jetRegion++) {
-        if (!jets[jetRegion].loaded) {  // Skip over regions we aren't studying
+    for (std::list<std::string>::iterator iter = files.begin(); iter != files.end(); ++iter) {
+        if (cache.load(*iter, partial)) {
             continue;
         }
-            // 1D histograms to store number of truth jets and reco jets for each energy bin
-        jets[jetRegion].truthEnergy = new TH1F(Form("truth_energy_%s", jets[jetRegion].descriptiveName.c_str()), "", num_bins, min_energy, max_energy);
-        jets[jetRegion].matchedEnergy  = new TH1F(Form("reco_energy_%s", jets[jetRegion].descriptiveName.c_str()),  "", num_bins, min_energy, max_energy);
-        for (std::list<std::string>::iterator iter = jets[jetRegion].files.begin(); iter != jets[jetRegion].files.end(); ++iter) {
+        partial.reset();
+        for (size_t jetRegion = 0; jetRegion < jets.size(); jetRegion++) {
+            truthEnergyFill[jetRegion].Reset();
+            matchedEnergyFill[jetRegion].Reset();
+        }
+        if (isColumnCache(*iter)) {
+            fileKey = bootstrapFileKey(columnCacheSource(*iter));
+            uint64_t bytes = 0;
+            uint64_t rows = scanTruthJets(*iter, classifier.minEta(), classifier.maxEta(), fillEntry, bytes);
+            timer.count(rows, bytes);
+        }
+        else {
             TFile *inFile = TFile::Open((*iter).c_str());       // open root file
             if (inFile == nullptr) {
                 std::cerr << "Could not open file " << *iter << std::endl;
@@ -92,53 +143,73 @@ void jetEfficiency(std::string centralFileList = "", std::string forwardFileList
             }
             TTree *jetTree = (TTree*) inFile->Get("ntp_truthjet"); // get truthjet tree
             if (jetTree == nullptr) {
-                std::cerr << "Could not file jet tree" << std::endl;
+                std::cerr << "Could not find jet tree" << std::endl;
+                inFile->Close();
                 continue;
             }
 
+            fileKey = bootstrapFileKey(*iter);
             float truthE, recoE;
             float pos[4];
 
             jetTree->SetBranchAddress("ge", &truthE);
-            jetTree->SetBranchAddress("e", &recoE);
-            jetTree->SetBranchAddress("geta", &pos[0]);
-            jetTree->SetBranchAddress("gphi", &pos[1]);
-            jetTree->SetBranchAddress("eta", &pos[2]);
-            jetTree->SetBranchAddress("phi", &pos[3]);
-
-            for (uint32_t i = 0; i < jetTree->GetEntries(); i++) {
-                jetTree->GetEntry(i);
-                if (std::isnan(truthE)) {
-                    continue;
-                }
-                if (pos[0] < jets[jetRegion].minEta || pos[0] > jets[jetRegion].maxEta) {
-                    continue;
+            if (addDerivedColumns(jetTree, *iter, regionHash, {"ge"}, derivedDir)) {
+                // Precomputed matching distance and regions, no reco energy needed
+                float distance;
+                uint32_t regionMask;
+                jetTree->SetBranchAddress("dR2", &distance);
+                jetTree->SetBranchAddress("region", &regionMask);
+                for (uint32_t i = 0; i < jetTree->GetEntries(); i++) {
+                    jetTree->GetEntry(i);
+                    if (regionMask != 0) {
+                        fillTruth(i, truthE, regionMask, matching.Accept(distance));
+                    }
                 }
-                // Do we filter on R for efficiency? Probably
-                
-                jets[jetRegion].truthEnergy->Fill(truthE);
-                if (r2 < calculateDistance(pos)) {
-                    continue;
-                }
-                if (std::isnan(truthE) || std::isnan(recoE)) {
-                    continue;
+            }
+            else {
+                jetTree->SetBranchAddress("e", &recoE);
+                jetTree->SetBranchAddress("geta", &pos[0]);
+                jetTree->SetBranchAddress("gphi", &pos[1]);
+                jetTree->SetBranchAddress("eta", &pos[2]);
+                jetTree->SetBranchAddress("phi", &pos[3]);
+                for (uint32_t i = 0; i < jetTree->GetEntries(); i++) {
+                    jetTree->GetEntry(i);
+                    fillEntry(i, truthE, recoE, pos, matching.Distance2(pos));
                 }
-                jets[jetRegion].matchedEnergy->Fill(truthE);
-                // std::cout << truthE << "\t" << recoE << std::endl;
-                // std::cout << pos[0] << "\t" << pos[1] << std::endl;
             }
+            timer.count(jetTree->GetEntries(), inFile->GetBytesRead());
             inFile->Close();
         }
+        for (size_t jetRegion = 0; jetRegion < jets.size(); jetRegion++) {
+            truthEnergyFill[jetRegion].AddTo(truthEnergy[jetRegion]);
+            matchedEnergyFill[jetRegion].AddTo(matchedEnergy[jetRegion]);
+        }
+        partial.merge();
+        cache.store(*iter, partial);
     }
+    cache.report();
 
+    timer.start("analysis");
     // Calculate efficiencies
     // efficiency = (num matched) / (num truth)
-    for (uint8_t jetRegion = 0; jetRegion < NUM_REGIONS; jetRegion++) {
-        if (!jets[jetRegion].loaded) {
-            continue;
-        }
+    for (size_t jetRegion = 0; jetRegion < jets.size(); jetRegion++) {
         jets[jetRegion].energy = (float*)malloc(num_bins * sizeof(float));
         jets[jetRegion].efficiency = (float*)malloc(num_bins * sizeof(float));
+        jets[jetRegion].efficiencyError = (float*)malloc(num_bins * sizeof(float));
+
+        // Error is the spread of the efficiency over the bootstrap replicas
+        bootstrapSpread efficiencySpread(num_bins + 1);
+        for (int replica = 0; replica < bootstrapReplicas; replica++) {
+            TH1 *truthReplica = bootstrapReplica(jets[jetRegion].truthEnergy, jets[jetRegion].truthBootstrap, replica);
+            TH1 *matchedReplica = bootstrapReplica(jets[jetRegion].matchedEnergy, jets[jetRegion].matchedBootstrap, replica);
+            for (uint32_t i = 1; i < num_bins; i++) {
+                if (truthReplica->GetBinContent(i) > 0) {
+                    efficiencySpread.add(i, matchedReplica->GetBinContent(i) / truthReplica->GetBinContent(i));
+                }
+            }
+            delete truthReplica;
+            delete matchedReplica;
+        }
         uint32_t fullBins = 0;
         for (uint32_t i = 1; i < num_bins; i++) {
             if (jets[jetRegion].truthEnergy->GetBinContent(i) == 0 || jets[jetRegion].matchedEnergy->GetBinContent(i) == 0) {
@@ -146,84 +217,86 @@ void jetEfficiency(std::string centralFileList = "", std::string forwardFileList
             }
             jets[jetRegion].energy[fullBins] = jets[jetRegion].truthEnergy->GetBinCenter(i);
             jets[jetRegion].efficiency[fullBins] = jets[jetRegion].matchedEnergy->GetBinContent(i) / jets[jetRegion].truthEnergy->GetBinContent(i);
+            jets[jetRegion].efficiencyError[fullBins] = efficiencySpread.error(i);
+            summary.add(jets[jetRegion].descriptiveName, "efficiency", i, jets[jetRegion].energy[fullBins], jets[jetRegion].efficiency[fullBins],
+                        jets[jetRegion].efficiencyError[fullBins], jets[jetRegion].truthEnergy->GetBinContent(i));
             // std::cout << jets[jetRegion].matchedEnergy->GetBinContent(i) << "\t" << jets[jetRegion].truthEnergy->GetBinContent(i) << std::endl;
             fullBins++;
         }
         jets[jetRegion].fullBins = fullBins;
         std::cout << "filled " << fullBins << " bins in " << jets[jetRegion].descriptiveName << " region" << std::endl;
     }
+    summary.write();
 
     // plotting
-    TCanvas *efficiencyCanvas = new TCanvas("jet_efficiency", "", 1000, 500);
-    efficiencyCanvas->Divide(2, 1);
-
-    // TODO make this handle different selections of regions better
-    efficiencyCanvas->cd(1);
-    THStack *stack = new THStack("jet_energy", "");
-    TLegend *histLegend = new TLegend(0.45, 0.70, 0.9, 0.9);
-    for (uint8_t jetRegion = 0; jetRegion < NUM_REGIONS; jetRegion++) {
-        if (!jets[jetRegion].loaded) {
-            continue;
+    renderQueue renderer(formats);
+    if (renderer.enabled()) {
+        timer.start("render");
+        TCanvas *efficiencyCanvas = new TCanvas("jet_efficiency", "", 1000, 500);
+        efficiencyCanvas->Divide(2, 1);
+
+        efficiencyCanvas->cd(1);
+        THStack *stack = new THStack("jet_energy", "");
+        TLegend *histLegend = new TLegend(0.45, 0.70, 0.9, 0.9);
+        for (size_t jetRegion = 0; jetRegion < jets.size(); jetRegion++) {
+            jets[jetRegion].truthEnergy->SetLineColor(jets[jetRegion].color);
+            jets[jetRegion].matchedEnergy->SetLineColor(jets[jetRegion].secondaryColor);
+            stack->Add(jets[jetRegion].truthEnergy);
+            stack->Add(jets[jetRegion].matchedEnergy);
+            histLegend->AddEntry(jets[jetRegion].truthEnergy, Form("%s Truth Jets", jets[jetRegion].descriptiveName.c_str()));
+            histLegend->AddEntry(jets[jetRegion].matchedEnergy, Form("%s Matched Jets", jets[jetRegion].descriptiveName.c_str()));
         }
-        jets[jetRegion].truthEnergy->SetLineColor(jets[jetRegion].color);
-        jets[jetRegion].matchedEnergy->SetLineColor(jets[jetRegion].secondaryColor);
-        stack->Add(jets[jetRegion].truthEnergy);
-        stack->Add(jets[jetRegion].matchedEnergy);
-        histLegend->AddEntry(jets[jetRegion].truthEnergy, Form("%s Truth Jets", jets[jetRegion].descriptiveName.c_str()));
-        histLegend->AddEntry(jets[jetRegion].matchedEnergy, Form("%s Matched Jets", jets[jetRegion].descriptiveName.c_str()));
-    }
-    stack->Draw("nostack");
-    stack->SetTitle("Jet Energy");
-    stack->GetXaxis()->SetTitle("Jet Energy");
-    stack->GetYaxis()->SetTitle("Counts");
-    histLegend->SetTextSize(0.035);
-    histLegend->Draw();
-    gPad->SetLogy();
+        stack->Draw("nostack");
+        stack->SetTitle("Jet Energy");
+        stack->GetXaxis()->SetTitle("Jet Energy");
+        stack->GetYaxis()->SetTitle("Counts");
+        histLegend->SetTextSize(0.035);
+        histLegend->Draw();
+        gPad->SetLogy();
     
 
-    efficiencyCanvas->cd(2);
-    // gPad->SetLeftMargin(0.1);
-    TMultiGraph *mGraph = new TMultiGraph();
-    TLegend *graphLegend = new TLegend(0.45, 0.8, 0.9, 0.9);
-    for (uint8_t jetRegion = 0; jetRegion < NUM_REGIONS; jetRegion++) {
-        if (!jets[jetRegion].loaded) {
-            continue;
+        efficiencyCanvas->cd(2);
+        // gPad->SetLeftMargin(0.1);
+        TMultiGraph *mGraph = new TMultiGraph();
+        TLegend *graphLegend = new TLegend(0.45, 0.8, 0.9, 0.9);
+        for (size_t jetRegion = 0; jetRegion < jets.size(); jetRegion++) {
+            jets[jetRegion].efficiencyGraph = new TGraphErrors(jets[jetRegion].fullBins, jets[jetRegion].energy, jets[jetRegion].efficiency, nullptr, jets[jetRegion].efficiencyError);
+            jets[jetRegion].efficiencyGraph->SetLineColor(jets[jetRegion].color);
+            jets[jetRegion].efficiencyGraph->SetMarkerColor(jets[jetRegion].color + 2);
+            jets[jetRegion].efficiencyGraph->SetMarkerSize(jets[jetRegion].markerSize);
+            jets[jetRegion].efficiencyGraph->SetMarkerStyle(jets[jetRegion].marker);
+            mGraph->Add(jets[jetRegion].efficiencyGraph);
+            graphLegend->AddEntry(jets[jetRegion].efficiencyGraph, Form("%s Jet Efficiency", jets[jetRegion].descriptiveName.c_str()));
         }
-        jets[jetRegion].efficiencyGraph = new TGraph(jets[jetRegion].fullBins, jets[jetRegion].energy, jets[jetRegion].efficiency);
-        jets[jetRegion].efficiencyGraph->SetLineColor(jets[jetRegion].color);
-        jets[jetRegion].efficiencyGraph->SetMarkerColor(jets[jetRegion].color + 2);
-        jets[jetRegion].efficiencyGraph->SetMarkerSize(jets[jetRegion].markerSize);
-        jets[jetRegion].efficiencyGraph->SetMarkerStyle(jets[jetRegion].marker);
-        mGraph->Add(jets[jetRegion].efficiencyGraph);
-        graphLegend->AddEntry(jets[jetRegion].efficiencyGraph, Form("%s Jet Efficiency", jets[jetRegion].descriptiveName.c_str()));
-    }
-    mGraph->SetTitle("Jet Efficiency");
-    mGraph->GetXaxis()->SetTitle("Jet Energy");
-    mGraph->GetYaxis()->SetTitle("Efficiency");
-    mGraph->Draw("ALP");
-    graphLegend->SetTextSize(0.035);
-    graphLegend->Draw();
-    // gPad->SetLogy();
-    efficiencyCanvas->SaveAs("canvas.png");
-    efficiencyCanvas->SaveAs("canvas.c");
-
-    for (uint8_t jetRegion; jetRegion < NUM_REGIONS; jetRegion++) {
-        if (!jets[jetRegion].loaded) {
-            continue;
+        mGraph->SetTitle("Jet Efficiency");
+        mGraph->GetXaxis()->SetTitle("Jet Energy");
+        mGraph->GetYaxis()->SetTitle("Efficiency");
+        mGraph->Draw("ALP");
+        graphLegend->SetTextSize(0.035);
+        graphLegend->Draw();
+        // gPad->SetLogy();
+        renderer.add(efficiencyCanvas, "canvas");
+        renderer.render();
+
+        delete efficiencyCanvas;
+        delete stack;
+        delete histLegend;
+        delete mGraph;      // deletes the efficiency graphs it holds
+        for (jetEfficiencyData &jet : jets) {
+            jet.efficiencyGraph = nullptr;
         }
+        delete graphLegend;
+    }
+
+    for (size_t jetRegion = 0; jetRegion < jets.size(); jetRegion++) {
         delete jets[jetRegion].truthEnergy;
         delete jets[jetRegion].matchedEnergy;
         delete jets[jetRegion].efficiencyGraph;
         free(jets[jetRegion].energy);
         free(jets[jetRegion].efficiency);
+        free(jets[jetRegion].efficiencyError);
+        delete jets[jetRegion].truthBootstrap;
+        delete jets[jetRegion].matchedBootstrap;
 
     }
-    delete efficiencyCanvas;
-    delete stack;
-    delete histLegend;
-    delete mGraph;
-    delete graphLegend;
-
-
-
 }
\ No newline at end of file
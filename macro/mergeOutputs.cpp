@@ -0,0 +1,170 @@
+#ifndef MERGEOUTPUTS_CPP
+#define MERGEOUTPUTS_CPP
+
+#include <TROOT.h>
+#include <TFile.h>
+#include <TFileMerger.h>
+#include <TTree.h>
+#include <TH1.h>
+#include <TSystem.h>
+#include <ROOT/TProcessExecutor.hxx>
+
+#include <string>
+#include <list>
+#include <vector>
+#include <iostream>
+#include <algorithm>
+#include <thread>
+
+#include "common.cpp"
+
+// Merging module outputs
+// mergeOutputs() merges the out.root files of a production (RecoJetTree and
+// ResponseHist of JetEnergyResolution) in a tree reduction: groups of fanIn
+// files are merged in parallel worker processes, then the merged groups, until
+// one file is left.  A group is fast merged, copying the compressed baskets as
+// they are, when all its files share one compression setting; only mixed
+// groups are recompressed.  Every merge is checked against the tree and
+// histogram entries of its inputs, and the final file against the whole list.
+
+const std::string mergeTree("RecoJetTree");
+const std::string mergeHist("ResponseHist");
+
+// Entries of the module output schema in one file
+class outputCounts {
+    public:
+        bool ok = false;
+        Long64_t treeEntries = 0;
+        double histEntries = 0;
+};
+
+outputCounts countOutput(TFile *file) {
+    outputCounts counts;
+    TTree *tree = nullptr;
+    TH1 *hist = nullptr;
+    file->GetObject(mergeTree.c_str(), tree);
+    file->GetObject(mergeHist.c_str(), hist);
+    if (tree == nullptr || hist == nullptr) {
+        return counts;
+    }
+    counts.ok = true;
+    counts.treeEntries = tree->GetEntries();
+    counts.histEntries = hist->GetEntries();
+    return counts;
+}
+
+// Merge inputs into output, returns the tree entries or -1 on failure
+Long64_t mergeGroup(const std::vector<std::string> &inputs, const std::string &output) {
+    TFileMerger merger(false);
+    merger.SetPrintLevel(0);
+    outputCounts total;
+    int compression = -1;
+    bool uniform = true;
+    for (const std::string &input : inputs) {
+        TFile *file = TFile::Open(input.c_str());
+        if (file == nullptr || file->IsZombie()) {
+            std::cerr << "Could not open file " << input << std::endl;
+            delete file;
+            return -1;
+        }
+        outputCounts counts = countOutput(file);
+        if (!counts.ok) {
+            std::cerr << "No " << mergeTree << " and " << mergeHist << " in " << input << std::endl;
+            delete file;
+            return -1;
+        }
+        total.treeEntries += counts.treeEntries;
+        total.histEntries += counts.histEntries;
+        if (compression < 0) {
+            compression = file->GetCompressionSettings();
+        }
+        uniform = uniform && file->GetCompressionSettings() == compression;
+        merger.AddAdoptFile(file);
+    }
+    merger.OutputFile(output.c_str(), "RECREATE", compression);
+    merger.SetFastMethod(uniform);
+    if (!merger.Merge()) {
+        std::cerr << "Could not merge into " << output << std::endl;
+        return -1;
+    }
+
+    TFile *merged = TFile::Open(output.c_str());
+    outputCounts counts = merged != nullptr ? countOutput(merged) : outputCounts();
+    delete merged;
+    if (!counts.ok || counts.treeEntries != total.treeEntries || counts.histEntries != total.histEntries) {
+        std::cerr << output << " has " << counts.treeEntries << " tree and " << counts.histEntries << " histogram entries, inputs have "
+                  << total.treeEntries << " and " << total.histEntries << std::endl;
+        return -1;
+    }
+    return total.treeEntries;
+}
+
+// Merge the files of fileList into output; intermediate levels go to tmpDir
+// (<output>.parts if empty), nProcesses = 0 runs one worker per core
+void mergeOutputs(std::string fileList, std::string output = "merged.root", int fanIn = 16, unsigned nProcesses = 0, std::string tmpDir = "") {
+    std::list<std::string> fileNames;
+    std::cout << "loaded " << readFileList(fileList, fileNames) << " files" << std::endl;
+    std::vector<std::string> files(fileNames.begin(), fileNames.end());
+    if (files.empty() || fanIn < 2) {
+        std::cerr << "Nothing to merge" << std::endl;
+        return;
+    }
+    if (tmpDir == "") {
+        tmpDir = output + ".parts";
+    }
+    gSystem->mkdir(tmpDir.c_str(), true);
+
+    Long64_t inputEntries = 0;
+    for (int level = 0; level == 0 || files.size() > 1; level++) {
+        // Groups of fanIn files, the last level writes the output itself
+        std::vector<std::vector<std::string>> groups;
+        for (size_t i = 0; i < files.size(); i += fanIn) {
+            groups.push_back(std::vector<std::string>(files.begin() + i, files.begin() + std::min(files.size(), i + fanIn)));
+        }
+        std::vector<std::string> targets;
+        for (size_t group = 0; group < groups.size(); group++) {
+            targets.push_back(groups.size() == 1 ? output : tmpDir + "/level" + std::to_string(level) + "_" + std::to_string(group) + ".root");
+        }
+        std::vector<unsigned> indices(groups.size());
+        for (unsigned i = 0; i < indices.size(); i++) {
+            indices[i] = i;
+        }
+        std::vector<Long64_t> entries;
+        unsigned workers = nProcesses != 0 ? nProcesses : std::max(1u, std::thread::hardware_concurrency());
+        if (groups.size() == 1) {  // not worth a fork
+            entries.push_back(mergeGroup(groups[0], targets[0]));
+        } else {
+            ROOT::TProcessExecutor pool(std::min<unsigned>(workers, groups.size()));
+            entries = pool.Map([&](unsigned i) { return mergeGroup(groups[i], targets[i]); }, indices);
+        }
+        if (std::find(entries.begin(), entries.end(), -1) != entries.end()) {
+            std::cerr << "Merging level " << level << " failed, intermediate files are kept in " << tmpDir << std::endl;
+            return;
+        }
+        Long64_t levelEntries = 0;
+        for (Long64_t groupEntries : entries) {
+            levelEntries += groupEntries;
+        }
+        if (level == 0) {
+            inputEntries = levelEntries;
+        } else {
+            for (const std::string &file : files) {   // the previous level's intermediate files
+                gSystem->Unlink(file.c_str());
+            }
+        }
+        std::cout << "level " << level << ": " << files.size() << " files into " << targets.size() << ", " << levelEntries << " entries" << std::endl;
+        files = targets;
+    }
+    gSystem->Unlink(tmpDir.c_str());
+
+    TFile *merged = TFile::Open(output.c_str());
+    outputCounts counts = merged != nullptr ? countOutput(merged) : outputCounts();
+    delete merged;
+    if (!counts.ok || counts.treeEntries != inputEntries) {
+        std::cerr << output << " has " << counts.treeEntries << " entries, the inputs have " << inputEntries << std::endl;
+        return;
+    }
+    std::cout << "merged " << fileNames.size() << " files, " << inputEntries << " entries into " << output << std::endl;
+}
+
+#endif // MERGEOUTPUTS_CPP
@@ -0,0 +1,158 @@
+#ifndef PARTIALCACHE_CPP
+#define PARTIALCACHE_CPP
+
+#include <TROOT.h>
+#include <TFile.h>
+#include <TH1.h>
+#include <TSystem.h>
+
+#include <string>
+#include <vector>
+#include <iostream>
+
+#include "fileCatalog.cpp"
+
+// Incremental analysis
+// The histograms a macro fills from a single input file are cached in
+// <cacheDir>/<key>.root, where the key hashes the file path, size, mtime and
+// the analysis configuration.  Rerunning over a grown file list only reads the
+// new or changed files and adds the cached partial histograms for the rest.
+
+// 64 bit FNV-1a, as hex
+std::string hashString(const std::string &text) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (char c : text) {
+        hash ^= (uint8_t)c;
+        hash *= 1099511628211ULL;
+    }
+    char hex[17];
+    snprintf(hex, sizeof(hex), "%016llx", (unsigned long long)hash);
+    return std::string(hex);
+}
+
+// Histograms filled per file (partials) and the totals they are summed into
+class partialHistograms {
+    public:
+        std::vector<TH1*> totals;
+        std::vector<TH1*> partials;
+
+        // Returns the partial to fill in place of total
+        TH1 *add(TH1 *total) {
+            TH1 *partial = (TH1*) total->Clone(Form("%s_partial", total->GetName()));
+            partial->SetDirectory(nullptr);
+            partial->Reset();
+            totals.push_back(total);
+            partials.push_back(partial);
+            return partial;
+        }
+
+        void reset() {
+            for (TH1 *partial : partials) {
+                partial->Reset();
+            }
+        }
+
+        void merge() {
+            for (size_t i = 0; i < totals.size(); i++) {
+                totals[i]->Add(partials[i]);
+            }
+        }
+
+        ~partialHistograms() {
+            for (TH1 *partial : partials) {
+                delete partial;
+            }
+        }
+};
+
+class partialCache {
+    public:
+        std::string cacheDir;       // empty disables the cache
+        std::string configHash;
+        uint32_t hits = 0;
+        uint32_t misses = 0;
+
+        partialCache(std::string dir, std::string config) : cacheDir(dir), configHash(hashString(config)) {
+            if (enabled()) {
+                gSystem->mkdir(cacheDir.c_str(), true);
+            }
+        }
+
+        bool enabled() const { return !cacheDir.empty(); }
+
+        std::string pathFor(const std::string &filePath) const {
+            catalogEntry entry;
+            entry.path = filePath;
+            statCatalogEntry(entry);
+            std::string key = hashString(Form("%s\t%lld\t%ld\t%s", filePath.c_str(), entry.size, entry.mtime, configHash.c_str()));
+            return cacheDir + "/" + key + ".root";
+        }
+
+        // Add the cached partials of filePath to the totals, false on a miss
+        bool load(const std::string &filePath, partialHistograms &hists) {
+            if (!enabled()) {
+                return false;
+            }
+            std::string path = pathFor(filePath);
+            if (gSystem->AccessPathName(path.c_str())) {    // true if it does NOT exist
+                misses++;
+                return false;
+            }
+            TFile *cached = TFile::Open(path.c_str());
+            if (cached == nullptr || cached->IsZombie()) {
+                delete cached;
+                misses++;
+                return false;
+            }
+            std::vector<TH1*> found;
+            for (size_t i = 0; i < hists.totals.size(); i++) {
+                TH1 *hist = (TH1*) cached->Get(Form("h%zu", i));
+                if (hist == nullptr || hist->GetNbinsX() != hists.totals[i]->GetNbinsX() || hist->GetNbinsY() != hists.totals[i]->GetNbinsY()) {
+                    break;
+                }
+                found.push_back(hist);
+            }
+            bool hit = found.size() == hists.totals.size();
+            if (hit) {
+                for (size_t i = 0; i < found.size(); i++) {
+                    hists.totals[i]->Add(found[i]);
+                }
+                hits++;
+            }
+            else {
+                misses++;
+            }
+            cached->Close();
+            delete cached;
+            return hit;
+        }
+
+        // Write the partials, via a temporary file so a crash never leaves a truncated entry
+        void store(const std::string &filePath, const partialHistograms &hists) {
+            if (!enabled()) {
+                return;
+            }
+            std::string path = pathFor(filePath);
+            std::string tmpPath = path + Form(".%d.tmp", gSystem->GetPid());
+            TFile *out = TFile::Open(tmpPath.c_str(), "RECREATE");
+            if (out == nullptr || out->IsZombie()) {
+                std::cerr << "Could not write cache file " << tmpPath << std::endl;
+                delete out;
+                return;
+            }
+            for (size_t i = 0; i < hists.partials.size(); i++) {
+                out->WriteTObject(hists.partials[i], Form("h%zu", i));
+            }
+            out->Close();
+            delete out;
+            gSystem->Rename(tmpPath.c_str(), path.c_str());
+        }
+
+        void report() const {
+            if (enabled()) {
+                std::cout << "partial cache: " << hits << " files reused, " << misses << " files processed" << std::endl;
+            }
+        }
+};
+
+#endif // PARTIALCACHE_CPP
@@ -0,0 +1,141 @@
+#include <TROOT.h>
+#include <TFile.h>
+#include <TTree.h>
+#include <TH1D.h>
+#include <TCanvas.h>
+#include <TStyle.h>
+#include <TLegend.h>
+#include <THStack.h>
+#include <TEntryList.h>
+
+#include <iostream>
+#include <string>
+#include <list>
+#include <vector>
+
+#include "common.cpp"
+#include "render.cpp"
+#include "stageTimer.cpp"
+#include "entryIndex.cpp"
+
+// Response (reco - truth) / truth of the matched jets in one truth energy
+// slice, e.g. plotEnergySlice("files.list", 20, 25), per region.  Files with an
+// entry index (entryIndex.cpp) only read the entries of the slice; the others
+// are scanned in full.
+
+// Hist Binning Parameters
+const int norm_min = -2;
+const int norm_max = 2;
+const int norm_resolution = 60;
+
+// Cuts
+const double r = 0.5;   // r^2 > dphi^2 + deta^2
+const JetMatching::DeltaRCut<JetMatching::TableWrap> matching(r);
+
+
+class jetSliceData: public jetData {
+    public:
+        TH1D *response;
+};
+
+
+void plotEnergySlice(std::string fileList, float sliceMin = 20, float sliceMax = 25, std::string regionConfig = "regions.txt",
+                     std::string indexDir = "", std::string formats = defaultFormats) {
+    std::vector<jetSliceData> jets;
+    std::cout << "loaded " << loadRegions(regionConfig, jets) << " regions from " << regionConfig << std::endl;
+    std::list<std::string> files;
+    std::cout << "loaded " << readCatalog(fileList, files) << " files" << std::endl;
+    regionClassifier classifier(jets);
+    for (jetSliceData &jet : jets) {
+        jet.response = new TH1D(Form("slice response, %s", jet.descriptiveName.c_str()), "", norm_resolution, norm_min, norm_max);
+    }
+
+    stageTimer timer("plotEnergySlice");
+    timer.start("read");
+    uint64_t totalEntries = 0;
+    uint64_t readEntries = 0;
+    for (const std::string &path : files) {
+        TFile *inFile = TFile::Open(path.c_str());
+        if (inFile == nullptr) {
+            std::cerr << "Could not open file " << path << std::endl;
+            continue;
+        }
+        TTree *jetTree = (TTree*) inFile->Get("ntp_truthjet");
+        if (jetTree == nullptr) {
+            std::cerr << "Could not find jet tree" << std::endl;
+            inFile->Close();
+            continue;
+        }
+        float truthE, recoE;
+        float pos[4];
+        jetTree->SetBranchAddress("ge", &truthE);
+        jetTree->SetBranchAddress("e", &recoE);
+        jetTree->SetBranchAddress("geta", &pos[0]);
+        jetTree->SetBranchAddress("gphi", &pos[1]);
+        jetTree->SetBranchAddress("eta", &pos[2]);
+        jetTree->SetBranchAddress("phi", &pos[3]);
+
+        TEntryList *slice = sliceEntries(path, sliceMin, sliceMax, classifier.minEta(), classifier.maxEta(), "ntp_truthjet", indexDir);
+        if (slice == nullptr) {
+            std::cerr << "No entry index for " << path << ", reading all entries" << std::endl;
+        }
+        else {
+            jetTree->SetEntryList(slice);   // the tree cache then only fetches baskets of the slice
+        }
+        Long64_t nEntries = slice != nullptr ? slice->GetN() : jetTree->GetEntries();
+        for (Long64_t i = 0; i < nEntries; i++) {
+            jetTree->GetEntry(slice != nullptr ? slice->GetEntry(i) : i);
+            if (!(truthE >= sliceMin && truthE < sliceMax) || std::isnan(recoE)) {
+                continue;
+            }
+            if (!matching.Accept(matching.Distance2(pos))) {
+                continue;
+            }
+            uint32_t regionMask = classifier.classify(pos[0], truthE);
+            float response = (recoE - truthE) / truthE;
+            for (uint32_t jetRegion = 0; regionMask != 0; jetRegion++, regionMask >>= 1) {
+                if (regionMask & 1) {
+                    jets[jetRegion].response->Fill(response);
+                }
+            }
+        }
+        totalEntries += jetTree->GetEntries();
+        readEntries += nEntries;
+        timer.count(nEntries, inFile->GetBytesRead());
+        jetTree->SetEntryList(nullptr);
+        delete slice;
+        inFile->Close();
+    }
+    std::cout << "read " << readEntries << " of " << totalEntries << " entries" << std::endl;
+
+    timer.start("analysis");
+    for (jetSliceData &jet : jets) {
+        std::cout << jet.descriptiveName << "\t" << sliceMin << "-" << sliceMax << " GeV\tmean " << jet.response->GetMean()
+                  << " +- " << jet.response->GetMeanError() << "\tRMS " << jet.response->GetRMS() << "\tjets " << jet.response->GetEntries() << std::endl;
+    }
+
+    renderQueue renderer(formats);
+    if (!renderer.enabled()) {
+        return;
+    }
+    timer.start("render");
+    gStyle->SetPadRightMargin(0.12);
+    gStyle->SetPadLeftMargin(0.12);
+    gStyle->SetPadTopMargin(0.12);
+    gStyle->SetPadBottomMargin(0.12);
+    TCanvas *sliceCanvas = new TCanvas("energy_slice", "", 500, 500);
+    THStack *sliceStack = new THStack();
+    TLegend *sliceLegend = new TLegend(0.65, 0.8, 0.87, 0.87);
+    for (jetSliceData &jet : jets) {
+        jet.response->SetLineColor(jet.color);
+        sliceStack->Add(jet.response);
+        sliceLegend->AddEntry(jet.response, Form("%s Jets", jet.descriptiveName.c_str()));
+    }
+    sliceStack->Draw("nostack");
+    sliceStack->SetTitle(Form("%g - %g GeV Profile", sliceMin, sliceMax));
+    sliceStack->GetXaxis()->SetTitle("(reco - truth) / truth");
+    sliceStack->GetYaxis()->SetTitle("Counts");
+    sliceLegend->Draw();
+    renderer.add(sliceCanvas, "energySlice");
+    renderer.render();
+}
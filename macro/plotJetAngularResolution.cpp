@@ -7,6 +7,8 @@
 #include <TCanvas.h>
 #include <TStyle.h>
 #include <TGraph.h>
+#include <TGraphErrors.h>
+#include <TH2I.h>
 #include <TLegend.h>
 #include <THStack.h>
 #include <TF1.h>
@@ -18,8 +20,16 @@
 #include <fstream>
 #include <string>
 #include <list>
+#include <vector>
 
 #include "common.cpp"
+#include "partialCache.cpp"
+#include "bootstrap.cpp"
+#include "render.cpp"
+#include "summary.cpp"
+#include "stageTimer.cpp"
+#include "columnCache.cpp"
+#include "derivedColumns.cpp"
 
 // Hist Binning Parameters
 const int bins_1d = 150;
@@ -29,6 +39,7 @@ const double phiRange = TMath::Pi() + 0.1;
 const double truthEtaRange = 5;
 const double recoEtaRange = 5;
 const double r = 0.4;
+const JetMatching::DeltaRCut<JetMatching::TableWrap> matching(r);
 
 const double phiMin = -1 * phiRange;
 const double phiMax = phiRange;
@@ -43,112 +54,171 @@ class jetAngularData: public jetData {
         TH2F *etaHist;
         TH2F *normalizedPhiHist;
         TH2F *normalizedEtaHist;
+        TH2I *normalizedPhiBootstrap;
+        TH2I *normalizedEtaBootstrap;
 
         TH1D *etaProjection;
         TProfile *etaProfile;
         double *eta, *etaScale, *etaResolution;
+        double *etaScaleError, *etaResolutionError;
         int fullEtaBins;
-        TGraph *etaScaleGraph;
-        TGraph *etaResolutionGraph;
+        TGraphErrors *etaScaleGraph;
+        TGraphErrors *etaResolutionGraph;
 
         TH1D *phiProjection;
         TProfile *phiProfile;
         double *phi, *phiScale, *phiResolution;
+        double *phiScaleError, *phiResolutionError;
         int fullPhiBins;
-        TGraph *phiScaleGraph;
-        TGraph *phiResolutionGraph;
+        TGraphErrors *phiScaleGraph;
+        TGraphErrors *phiResolutionGraph;
 };
 
-void plotJetAngularResolution(std::string centralFileList = "", std::string forwardFileList = "", std::string backwardFileList = "") {
-    // Initialization, i.e. loading file list and creating histogram
-    jetAngularData jets[NUM_REGIONS];
-    if (centralFileList != "") {
-        jets[CENTRAL].loaded = true;
-        jets[CENTRAL].descriptiveName = std::string("Central");
-        std::cout << "loaded " << readFileList(centralFileList, jets[CENTRAL].files) << " files in central region" << std::endl;
-        jets[CENTRAL].color = kRed;
-        jets[CENTRAL].secondaryColor = kMagenta;
-        jets[CENTRAL].marker = 21;
-        jets[CENTRAL].markerSize = 1;
+void plotJetAngularResolution(std::string fileList, std::string regionConfig = "regions.txt", std::string cacheDir = "", std::string formats = defaultFormats,
+                              std::string summaryFile = "jetAngularResolution.csv", std::string derivedDir = "") {
+    // Initialization, i.e. loading regions, file list and creating histograms
+    std::vector<jetAngularData> jets;
+    std::cout << "loaded " << loadRegions(regionConfig, jets) << " regions from " << regionConfig << std::endl;
+    std::list<std::string> files;
+    std::cout << "loaded " << readCatalog(fileList, files) << " files" << std::endl;
+    regionClassifier classifier(jets);
+
+    // All regions are filled in one read of each file, and cached together per file
+    partialCache cache(cacheDir, std::string(Form("plotJetAngularResolution %d %d %f %f %f %f %f %d %llu\n", bins_2d, bin_resolution, phiRange,
+                                                  truthEtaMin, truthEtaMax, recoEtaMin, r, bootstrapReplicas, (unsigned long long)bootstrapSeed))
+                             + regionConfigText(regionConfig));
+    summaryWriter summary(summaryFile, "plotJetAngularResolution", cache.configHash);
+    partialHistograms partial;
+    std::vector<TH1*> phiHist, etaHist, normalizedPhiHist, normalizedEtaHist;
+    std::vector<bootstrapHist> normalizedPhiBootstrap, normalizedEtaBootstrap;
+    for (jetAngularData &jet : jets) {
+        jet.phiHist = new TH2F(Form("%s phi", jet.descriptiveName.c_str()), "", bins_2d, phiMin, phiMax, bins_2d, phiMin, phiMax);
+        jet.etaHist = new TH2F(Form("%s eta", jet.descriptiveName.c_str()), "", bins_2d, truthEtaMin, truthEtaMax, bins_2d, recoEtaMin, recoEtaMax);
+        jet.normalizedEtaHist = new TH2F(Form("%s eta, (reco-truth)/truth", jet.descriptiveName.c_str()), "", bin_resolution, recoEtaMin, recoEtaMax, bin_resolution, recoEtaMin, recoEtaMax);
+        jet.normalizedPhiHist = new TH2F(Form("%s phi, (reco-truth)/truth", jet.descriptiveName.c_str()), "", bin_resolution, phiMin, phiMax, bin_resolution, phiMin, phiMax);
+        jet.normalizedPhiBootstrap = bootstrapCounts(jet.normalizedPhiHist);
+        jet.normalizedEtaBootstrap = bootstrapCounts(jet.normalizedEtaHist);
+        phiHist.push_back(partial.add(jet.phiHist));
+        etaHist.push_back(partial.add(jet.etaHist));
+        normalizedPhiHist.push_back(partial.add(jet.normalizedPhiHist));
+        normalizedEtaHist.push_back(partial.add(jet.normalizedEtaHist));
+        normalizedPhiBootstrap.push_back(bootstrapHist(jet.normalizedPhiHist, partial.add(jet.normalizedPhiBootstrap)));
+        normalizedEtaBootstrap.push_back(bootstrapHist(jet.normalizedEtaHist, partial.add(jet.normalizedEtaBootstrap)));
     }
-    if (forwardFileList != "") {
-        jets[FORWARD].loaded = true;
-        jets[FORWARD].descriptiveName = std::string("Forward");
-        std::cout << "loaded " << readFileList(forwardFileList, jets[FORWARD].files) << " files in forward region" << std::endl;
-        jets[FORWARD].color = kBlue;
-        jets[FORWARD].secondaryColor = kCyan;
-        jets[FORWARD].marker = 21;
-        jets[FORWARD].markerSize = 1;
-    }
-    if (backwardFileList != "") {
-        jets[BACKWARD].loaded = true;
-        jets[BACKWARD].descriptiveName = std::string("Backward");
-        std::cout << "loaded " << readFileList(backwardFileList, jets[BACKWARD].files) << " files in backward region" << std::endl;
-        jets[BACKWARD].color = kGreen + 2;
-        jets[BACKWARD].secondaryColor = kYellow + 1;
-        jets[BACKWARD].marker = 21;
-        jets[BACKWARD].markerSize = 1;
-    }
-
+    bootstrapWeights weights;
+
+    // Fill the regions of regionMask with a matched jet, pos with the wrap
+    // adjusted reco phi, dEta = pos[2] - pos[0] and dPhi = pos[3] - pos[1]
+    uint64_t fileKey = 0;
+    auto fillMatched = [&](uint64_t entry, const float *pos, uint32_t regionMask, float dEta, float dPhi) {
+        weights.generate(fileKey, entry);
+        for (uint32_t jetRegion = 0; regionMask != 0; jetRegion++, regionMask >>= 1) {
+            if (!(regionMask & 1)) {
+                continue;
+            }
+            phiHist[jetRegion]->Fill(pos[1], pos[3]);
+            normalizedPhiHist[jetRegion]->Fill(pos[1], dPhi);
+            normalizedPhiBootstrap[jetRegion].Fill(pos[1], dPhi, weights);
+            etaHist[jetRegion]->Fill(pos[0], pos[2]);
+            normalizedEtaHist[jetRegion]->Fill(pos[0], dEta);
+            normalizedEtaBootstrap[jetRegion].Fill(pos[0], dEta, weights);
+        }
+    };
 
-    for (uint8_t jetRegion = 0; jetRegion < NUM_REGIONS; jetRegion++) {
-        if (!jets[jetRegion].loaded) {
+    // Fill every region this jet falls in, distance = matching.Distance2(pos)
+    auto fillEntry = [&](uint64_t entry, float truthE, float recoE, float *pos, float distance) {
+        // Accepted distances have no NaN angles
+        if (!matching.Accept(distance)) {
+            return;
+        }
+        // Regions this jet falls in, nothing for NaN truth
+        uint32_t regionMask = classifier.classify(pos[0], truthE);
+        if (regionMask == 0) {
+            return;
+        }
+        fillMatched(entry, pos, regionMask, pos[2] - pos[0], pos[3] - pos[1]);
+    };
+    std::string regionHash = hashString(regionConfigText(regionConfig));
+
+    stageTimer timer("plotJetAngularResolution");
+    timer.start("read");
+    // Loop over files
+    for (std::list<std::string>::iterator iter = files.begin(); iter != files.end(); ++iter) {
+        if (cache.load(*iter, partial)) {
             continue;
         }
-        jets[jetRegion].phiHist = new TH2F(Form("%s phi", jets[jetRegion].descriptiveName.c_str()), "", bins_2d, phiMin, phiMax, bins_2d, phiMin, phiMax);
-        jets[jetRegion].etaHist = new TH2F(Form("%s eta", jets[jetRegion].descriptiveName.c_str()), "", bins_2d, truthEtaMin, truthEtaMax, bins_2d, recoEtaMin, recoEtaMax);
-        jets[jetRegion].normalizedEtaHist = new TH2F(Form("%s eta, (reco-truth)/truth", jets[jetRegion].descriptiveName.c_str()), "", bin_resolution, recoEtaMin, recoEtaMax, bin_resolution, recoEtaMin, recoEtaMax);
-        jets[jetRegion].normalizedPhiHist = new TH2F(Form("%s phi, (reco-truth)/truth", jets[jetRegion].descriptiveName.c_str()), "", bin_resolution, phiMin, phiMax, bin_resolution, phiMin, phiMax);
-
-        // Loop over files
-        for (std::list<std::string>::iterator iter = jets[jetRegion].files.begin(); iter != jets[jetRegion].files.end(); ++iter) {
+        partial.reset();
+        if (isColumnCache(*iter)) {
+            fileKey = bootstrapFileKey(columnCacheSource(*iter));
+            uint64_t bytes = 0;
+            uint64_t rows = scanTruthJets(*iter, classifier.minEta(), classifier.maxEta(), fillEntry, bytes);
+            timer.count(rows, bytes);
+        }
+        else {
             TFile *inFile = TFile::Open((*iter).c_str());
+            if (inFile == nullptr) {
+                std::cerr << "Could not open file " << *iter << std::endl;
+                continue;
+            }
             TTree *truthJets = (TTree*) inFile->Get("ntp_truthjet");
             if (truthJets == nullptr) {
-                std::cout << "Could not find jet tree" << std::endl;
+                std::cerr << "Could not find jet tree" << std::endl;
+                inFile->Close();
+                continue;
             }
+            fileKey = bootstrapFileKey(*iter);
+            float truthE;
             float pos[4];
             truthJets->SetBranchAddress("geta", &pos[0]);
             truthJets->SetBranchAddress("gphi", &pos[1]);
             truthJets->SetBranchAddress("eta", &pos[2]);
-            truthJets->SetBranchAddress("phi", &pos[3]);
-
-
-            // Create histograms
-            for (uint32_t i = 0; i < truthJets->GetEntries(); i++) {
-                truthJets->GetEntry(i);
-                if (r * r < calculateDistance(pos)) {
-                    continue;
-                }
-                // if (abs(truthEta) > 1.5) {
-                //     continue;
-                // }
-                if (!std::isnan(pos[1]) && !std::isnan(pos[3])) {
-                    jets[jetRegion].phiHist->Fill(pos[1], pos[3]);
-                    jets[jetRegion].normalizedPhiHist->Fill(pos[1], (pos[3] - pos[1]));
+            if (addDerivedColumns(truthJets, *iter, regionHash, {"geta", "gphi", "eta"}, derivedDir)) {
+                // Precomputed matching distance, regions and residuals, the reco phi follows from dPhi
+                float distance, dEta, dPhi;
+                uint32_t regionMask;
+                truthJets->SetBranchAddress("dR2", &distance);
+                truthJets->SetBranchAddress("region", &regionMask);
+                truthJets->SetBranchAddress("dEta", &dEta);
+                truthJets->SetBranchAddress("dPhi", &dPhi);
+                for (uint32_t i = 0; i < truthJets->GetEntries(); i++) {
+                    truthJets->GetEntry(i);
+                    if (matching.Accept(distance) && regionMask != 0) {
+                        pos[3] = pos[1] + dPhi;
+                        fillMatched(i, pos, regionMask, dEta, dPhi);
+                    }
                 }
-                if (!std::isnan(pos[0]) && !std::isnan(pos[2]))   {
-                    jets[jetRegion].etaHist->Fill(pos[0], pos[2]);
-                    jets[jetRegion].normalizedEtaHist->Fill(pos[0], (pos[2] - pos[0]));
+            }
+            else {
+                truthJets->SetBranchAddress("ge", &truthE);     // only used to classify into regions
+                truthJets->SetBranchAddress("phi", &pos[3]);
+                for (uint32_t i = 0; i < truthJets->GetEntries(); i++) {
+                    truthJets->GetEntry(i);
+                    fillEntry(i, truthE, 0, pos, matching.Distance2(pos));   // no reco energy needed
                 }
-            
             }
+            timer.count(truthJets->GetEntries(), inFile->GetBytesRead());
             inFile->Close();
         }
+        partial.merge();
+        cache.store(*iter, partial);
     }
+    cache.report();
 
 
+    timer.start("analysis");
     // Calculate scale and resolution of the jet angularity measurement 
-    for (uint8_t jetRegion = 0; jetRegion < NUM_REGIONS; jetRegion++) {
-        if (!jets[jetRegion].loaded) {
-            continue;
-        }
+    for (size_t jetRegion = 0; jetRegion < jets.size(); jetRegion++) {
         jets[jetRegion].etaProfile = jets[jetRegion].normalizedEtaHist->ProfileX();
         jets[jetRegion].etaProjection = jets[jetRegion].normalizedEtaHist->ProjectionX();
         jets[jetRegion].etaProfile->BuildOptions(0, 0, "s");
         jets[jetRegion].eta = (double*)malloc(bin_resolution * sizeof(double));
         jets[jetRegion].etaScale = (double*)malloc(bin_resolution * sizeof(double));
         jets[jetRegion].etaResolution = (double*)malloc(bin_resolution * sizeof(double));
+        jets[jetRegion].etaScaleError = (double*)malloc(bin_resolution * sizeof(double));
+        jets[jetRegion].etaResolutionError = (double*)malloc(bin_resolution * sizeof(double));
+        bootstrapSpread etaScaleSpread(bin_resolution + 1);
+        bootstrapSpread etaResolutionSpread(bin_resolution + 1);
+        bootstrapProfileSpread(jets[jetRegion].normalizedEtaHist, jets[jetRegion].normalizedEtaBootstrap, etaScaleSpread, etaResolutionSpread);
         int fullEtaBins = 0;
         for (uint32_t i = 1; i <= bin_resolution; i++) {
             if (jets[jetRegion].etaProjection->GetBinContent(i) == 0) {
@@ -157,6 +227,13 @@ void plotJetAngularResolution(std::string centralFileList = "", std::string forw
             jets[jetRegion].eta[fullEtaBins] = jets[jetRegion].etaProfile->GetBinCenter(i);
             jets[jetRegion].etaScale[fullEtaBins] = jets[jetRegion].etaProfile->GetBinContent(i);
             jets[jetRegion].etaResolution[fullEtaBins] = jets[jetRegion].etaProfile->GetBinError(i);
+            jets[jetRegion].etaScaleError[fullEtaBins] = etaScaleSpread.error(i);
+            jets[jetRegion].etaResolutionError[fullEtaBins] = etaResolutionSpread.error(i);
+            double entries = jets[jetRegion].etaProjection->GetBinContent(i);
+            summary.add(jets[jetRegion].descriptiveName, "etaScale", i, jets[jetRegion].eta[fullEtaBins],
+                        jets[jetRegion].etaScale[fullEtaBins], jets[jetRegion].etaScaleError[fullEtaBins], entries);
+            summary.add(jets[jetRegion].descriptiveName, "etaResolution", i, jets[jetRegion].eta[fullEtaBins],
+                        jets[jetRegion].etaResolution[fullEtaBins], jets[jetRegion].etaResolutionError[fullEtaBins], entries);
             fullEtaBins++;
         }
         jets[jetRegion].fullEtaBins = fullEtaBins;
@@ -167,6 +244,11 @@ void plotJetAngularResolution(std::string centralFileList = "", std::string forw
         jets[jetRegion].phi = (double*)malloc(bin_resolution * sizeof(double));
         jets[jetRegion].phiScale = (double*)malloc(bin_resolution * sizeof(double));
         jets[jetRegion].phiResolution = (double*)malloc(bin_resolution * sizeof(double));
+        jets[jetRegion].phiScaleError = (double*)malloc(bin_resolution * sizeof(double));
+        jets[jetRegion].phiResolutionError = (double*)malloc(bin_resolution * sizeof(double));
+        bootstrapSpread phiScaleSpread(bin_resolution + 1);
+        bootstrapSpread phiResolutionSpread(bin_resolution + 1);
+        bootstrapProfileSpread(jets[jetRegion].normalizedPhiHist, jets[jetRegion].normalizedPhiBootstrap, phiScaleSpread, phiResolutionSpread);
         int fullPhiBins = 0;
         for (uint32_t i = 1; i <= bin_resolution; i++) {
             if (jets[jetRegion].phiProjection->GetBinContent(i) == 0) {
@@ -175,13 +257,26 @@ void plotJetAngularResolution(std::string centralFileList = "", std::string forw
             jets[jetRegion].phi[fullPhiBins] = jets[jetRegion].phiProfile->GetBinCenter(i);
             jets[jetRegion].phiScale[fullPhiBins] = jets[jetRegion].phiProfile->GetBinContent(i);
             jets[jetRegion].phiResolution[fullPhiBins] = jets[jetRegion].phiProfile->GetBinError(i);
+            jets[jetRegion].phiScaleError[fullPhiBins] = phiScaleSpread.error(i);
+            jets[jetRegion].phiResolutionError[fullPhiBins] = phiResolutionSpread.error(i);
+            double entries = jets[jetRegion].phiProjection->GetBinContent(i);
+            summary.add(jets[jetRegion].descriptiveName, "phiScale", i, jets[jetRegion].phi[fullPhiBins],
+                        jets[jetRegion].phiScale[fullPhiBins], jets[jetRegion].phiScaleError[fullPhiBins], entries);
+            summary.add(jets[jetRegion].descriptiveName, "phiResolution", i, jets[jetRegion].phi[fullPhiBins],
+                        jets[jetRegion].phiResolution[fullPhiBins], jets[jetRegion].phiResolutionError[fullPhiBins], entries);
             fullPhiBins++;
         }
         jets[jetRegion].fullPhiBins = fullPhiBins;
     }
+    summary.write();
 
 
     // Drawing
+    renderQueue renderer(formats);
+    if (!renderer.enabled()) {
+        return;
+    }
+    timer.start("render");
     gStyle->SetStatX(0.9);
     gStyle->SetStatY(0.42);
     gStyle->SetPadRightMargin(0.12);
@@ -257,17 +352,14 @@ void plotJetAngularResolution(std::string centralFileList = "", std::string forw
         jetEnergy->cd(1);
         TMultiGraph *etaMGraph = new TMultiGraph();
         TLegend *etaLegend = new TLegend();
-        for (uint8_t jetRegion = 0; jetRegion < NUM_REGIONS; jetRegion++) {
-            if (!jets[jetRegion].loaded) {
-                continue;
-            }
-            jets[jetRegion].etaScaleGraph = new TGraph(jets[jetRegion].fullEtaBins, jets[jetRegion].eta, jets[jetRegion].etaScale);
+        for (size_t jetRegion = 0; jetRegion < jets.size(); jetRegion++) {
+            jets[jetRegion].etaScaleGraph = new TGraphErrors(jets[jetRegion].fullEtaBins, jets[jetRegion].eta, jets[jetRegion].etaScale, nullptr, jets[jetRegion].etaScaleError);
             jets[jetRegion].etaScaleGraph->SetMarkerStyle(3);
             jets[jetRegion].etaScaleGraph->SetMarkerSize(2.5);
             jets[jetRegion].etaScaleGraph->SetMarkerColor(jets[jetRegion].color);
 
 
-            jets[jetRegion].etaResolutionGraph = new TGraph(jets[jetRegion].fullEtaBins, jets[jetRegion].eta, jets[jetRegion].etaResolution);
+            jets[jetRegion].etaResolutionGraph = new TGraphErrors(jets[jetRegion].fullEtaBins, jets[jetRegion].eta, jets[jetRegion].etaResolution, nullptr, jets[jetRegion].etaResolutionError);
             jets[jetRegion].etaResolutionGraph->SetMarkerStyle(5);
             jets[jetRegion].etaResolutionGraph->SetMarkerColor(jets[jetRegion].secondaryColor);
             jets[jetRegion].etaResolutionGraph->SetMarkerSize(2.5);
@@ -289,16 +381,13 @@ void plotJetAngularResolution(std::string centralFileList = "", std::string forw
         jetEnergy->cd(2);
         TMultiGraph *phiMGraph = new TMultiGraph();
         TLegend *phiLegend = new TLegend();
-        for (uint8_t jetRegion = 0; jetRegion < NUM_REGIONS; jetRegion++) {
-            if (!jets[jetRegion].loaded) {
-                continue;
-            }
-            jets[jetRegion].phiScaleGraph = new TGraph(jets[jetRegion].fullPhiBins, jets[jetRegion].phi, jets[jetRegion].phiScale);
+        for (size_t jetRegion = 0; jetRegion < jets.size(); jetRegion++) {
+            jets[jetRegion].phiScaleGraph = new TGraphErrors(jets[jetRegion].fullPhiBins, jets[jetRegion].phi, jets[jetRegion].phiScale, nullptr, jets[jetRegion].phiScaleError);
             jets[jetRegion].phiScaleGraph->SetMarkerStyle(3);
             jets[jetRegion].phiScaleGraph->SetMarkerSize(2.5);
             jets[jetRegion].phiScaleGraph->SetMarkerColor(jets[jetRegion].color);
 
-            jets[jetRegion].phiResolutionGraph = new TGraph(jets[jetRegion].fullPhiBins, jets[jetRegion].phi, jets[jetRegion].phiResolution);
+            jets[jetRegion].phiResolutionGraph = new TGraphErrors(jets[jetRegion].fullPhiBins, jets[jetRegion].phi, jets[jetRegion].phiResolution, nullptr, jets[jetRegion].phiResolutionError);
             jets[jetRegion].phiResolutionGraph->SetMarkerStyle(5);
             jets[jetRegion].phiResolutionGraph->SetMarkerSize(2.5);
             jets[jetRegion].phiResolutionGraph->SetMarkerColor(jets[jetRegion].secondaryColor);
@@ -320,8 +409,8 @@ void plotJetAngularResolution(std::string centralFileList = "", std::string forw
 
     }
     // jetEnergy->Draw();
-    jetEnergy->SaveAs("jetAngularScale.png");
-    jetEnergy->SaveAs("jetAngularScale.c");
+    renderer.add(jetEnergy, "jetAngularScale");
+    renderer.render();
 
 
     // Some cleanup
@@ -11,6 +11,8 @@
 #include <TLegend.h>
 #include <THStack.h>
 #include <TGraph.h>
+#include <TGraphErrors.h>
+#include <TH2I.h>
 #include <TF1.h>
 #include <TProfile.h>
 #include <TLatex.h>
@@ -19,10 +21,18 @@
 #include <fstream>
 #include <string>
 #include <list>
+#include <vector>
 
 #include "common.cpp"
-
-// TODO Error bars
+#include "partialCache.cpp"
+#include "resolutionFit.cpp"
+#include "bootstrap.cpp"
+#include "render.cpp"
+#include "summary.cpp"
+#include "stageTimer.cpp"
+#include "columnCache.cpp"
+#include "derivedColumns.cpp"
+#include "../src/FixedHistogram.h"
 
 
 // Hist Binning Parameters
@@ -36,11 +46,19 @@ const int norm_min = -2;
 const int norm_max = 2;
 const int norm_resolution = 60;
 
+// Compile time binning of the histograms filled in the entry loop
+typedef Binning2D<UniformAxis<bins_2d, min_bin, e_max>, UniformAxis<bins_2d, min_bin, e_max>> truthEnergyBinning;
+typedef Binning2D<UniformAxis<bins_resolution, min_bin, e_max>, UniformAxis<norm_resolution, norm_min, norm_max>> normalizedEnergyBinning;
+
 const float slice_energy = 3; // GeV
 
+// Scale and resolution from iterative gaussian fits to each energy slice,
+// otherwise the mean and RMS of the slice are used
+const bool fitResolution = true;
+
 // Cuts
-const double r = 0.5;   // r^2 < dphi^2 + deta^2
-const double r2 = r * r;
+const double r = 0.5;   // r^2 > dphi^2 + deta^2
+const JetMatching::DeltaRCut<JetMatching::TableWrap> matching(r);
 
 // Plotting
 // const std::string secondPlot("energyScale");
@@ -52,107 +70,193 @@ class jetEnergyData: public jetData {
     public:
         TH2F *truthEnergyHist;
         TH2F *normalizedEnergyHist;
+        TH2I *normalizedEnergyBootstrap;
         uint32_t fullBins;
         TProfile *profile;
         TH1D *projection;
         float *energy;
         float *scale;
         float *resolution;
-        TGraph *jetScale;
-        TGraph *jetResolution;
+        float *scaleError;
+        float *resolutionError;
+        TGraphErrors *jetScale;
+        TGraphErrors *jetResolution;
         TH1D *slice;
 };
 
 
-void plotJetEnergyScale(std::string centralFileList = "", std::string forwardFileList = "", std::string backwardFileList = "") {
-    // Initialization, i.e. loading file list and creating histogram
-    jetEnergyData jets[NUM_REGIONS];
-    if (centralFileList != "") {
-        jets[CENTRAL].loaded = true;
-        jets[CENTRAL].descriptiveName = std::string("Central");
-        std::cout << "loaded " << readFileList(centralFileList, jets[CENTRAL].files) << " files in central region" << std::endl;
-        jets[CENTRAL].color = kRed;
-        jets[CENTRAL].secondaryColor = kMagenta;
-        jets[CENTRAL].marker = 21;
-        jets[CENTRAL].markerSize = 1;
-        jets[CENTRAL].truthEnergyHist = new TH2F(Form("energy_ratio, %s", jets[CENTRAL].descriptiveName.c_str()), "", bins_2d, min_bin, e_max, bins_2d, min_bin, e_max);
-        jets[CENTRAL].normalizedEnergyHist = new TH2F(Form("reco-truth/truth, %s", jets[CENTRAL].descriptiveName.c_str()), "", bins_resolution, min_bin, e_max, norm_resolution, norm_min, norm_max);
-    }
-    if (forwardFileList != "") {
-        jets[FORWARD].loaded = true;
-        jets[FORWARD].descriptiveName = std::string("Forward");
-        std::cout << "loaded " << readFileList(forwardFileList, jets[FORWARD].files) << " files in forward region" << std::endl;
-        jets[FORWARD].color = kBlue;
-        jets[FORWARD].secondaryColor = kCyan;
-        jets[FORWARD].marker = 22;
-        jets[FORWARD].markerSize = 1.5;
-        jets[FORWARD].truthEnergyHist = new TH2F(Form("energy_ratio, %s", jets[FORWARD].descriptiveName.c_str()), "", bins_2d, min_bin, e_max, bins_2d, min_bin, e_max);
-        jets[FORWARD].normalizedEnergyHist = new TH2F(Form("reco-truth/truth, %s", jets[FORWARD].descriptiveName.c_str()), "", bins_resolution, min_bin, e_max, norm_resolution, norm_min, norm_max);
-    }
-    if (backwardFileList != "") {
-        jets[BACKWARD].loaded = true;
-        jets[BACKWARD].descriptiveName = std::string("Backward");
-        std::cout << "loaded " << readFileList(backwardFileList, jets[BACKWARD].files) << " files in backward region" << std::endl;
-        jets[BACKWARD].color = kGreen;
-        jets[BACKWARD].secondaryColor = kYellow + 1;
-        jets[BACKWARD].marker = 21;
-        jets[BACKWARD].markerSize = 1;
-        jets[BACKWARD].truthEnergyHist = new TH2F(Form("energy_ratio, %s", jets[BACKWARD].descriptiveName.c_str()), "", bins_2d, min_bin, e_max, bins_2d, min_bin, e_max);
-        jets[BACKWARD].normalizedEnergyHist = new TH2F(Form("reco-truth/truth, %s", jets[BACKWARD].descriptiveName.c_str()), "", bins_resolution, min_bin, e_max, norm_resolution, norm_min, norm_max);
+void plotJetEnergyScale(std::string fileList, std::string regionConfig = "regions.txt", std::string cacheDir = "", std::string formats = defaultFormats,
+                        std::string summaryFile = "jetEnergyScale.csv", std::string derivedDir = "") {
+    // Initialization, i.e. loading regions, file list and creating histograms
+    std::vector<jetEnergyData> jets;
+    std::cout << "loaded " << loadRegions(regionConfig, jets) << " regions from " << regionConfig << std::endl;
+    std::list<std::string> files;
+    std::cout << "loaded " << readCatalog(fileList, files) << " files" << std::endl;
+    regionClassifier classifier(jets);
+
+    // All regions are filled in one read of each file, and cached together per file
+    partialCache cache(cacheDir, std::string(Form("plotJetEnergyScale %d %d %d %d %d %d %f %d %llu\n", bins_2d, bins_resolution, min_bin, e_max,
+                                                  norm_min, norm_max, r, bootstrapReplicas, (unsigned long long)bootstrapSeed)) + regionConfigText(regionConfig));
+    summaryWriter summary(summaryFile, "plotJetEnergyScale", cache.configHash);
+    partialHistograms partial;
+    std::vector<TH1*> truthEnergyHist, normalizedEnergyHist;
+    std::vector<bootstrapHist> normalizedEnergyBootstrap;
+    std::vector<FixedHist<truthEnergyBinning>> truthEnergyFill(jets.size());
+    std::vector<FixedHist<normalizedEnergyBinning>> normalizedEnergyFill(jets.size());
+    for (jetEnergyData &jet : jets) {
+        jet.truthEnergyHist = new TH2F(Form("energy_ratio, %s", jet.descriptiveName.c_str()), "", bins_2d, min_bin, e_max, bins_2d, min_bin, e_max);
+        jet.normalizedEnergyHist = new TH2F(Form("reco-truth/truth, %s", jet.descriptiveName.c_str()), "", bins_resolution, min_bin, e_max, norm_resolution, norm_min, norm_max);
+        jet.normalizedEnergyBootstrap = bootstrapCounts(jet.normalizedEnergyHist);
+        truthEnergyHist.push_back(partial.add(jet.truthEnergyHist));
+        normalizedEnergyHist.push_back(partial.add(jet.normalizedEnergyHist));
+        normalizedEnergyBootstrap.push_back(bootstrapHist(jet.normalizedEnergyHist, partial.add(jet.normalizedEnergyBootstrap)));
     }
+    bootstrapWeights weights;
+
+    // Fill the regions of regionMask with a matched jet
+    uint64_t fileKey = 0;
+    auto fillMatched = [&](uint64_t entry, float truthE, float recoE, uint32_t regionMask, float response) {
+        int responseCell = normalizedEnergyBinning::Cell(truthE, response);
+        weights.generate(fileKey, entry);
+        for (uint32_t jetRegion = 0; regionMask != 0; jetRegion++, regionMask >>= 1) {
+            if (!(regionMask & 1)) {
+                continue;
+            }
+            truthEnergyFill[jetRegion].Fill(truthE, recoE);
+            normalizedEnergyFill[jetRegion].Fill(truthE, response);
+            normalizedEnergyBootstrap[jetRegion].fillCell(responseCell, weights);
+        }
+        // std::cout << truthE << "\t" << recoE << std::endl;
+    };
+
+    // Fill every region this jet falls in, distance = matching.Distance2(pos)
+    auto fillEntry = [&](uint64_t entry, float truthE, float recoE, float *pos, float distance) {
+        if (!matching.Accept(distance)) {
+            return;
+        }
+        if (std::isnan(recoE)) {
+            return;
+        }
+        // Regions this jet falls in, nothing for NaN truth
+        uint32_t regionMask = classifier.classify(pos[0], truthE);
+        if (regionMask == 0) {
+            return;
+        }
+        fillMatched(entry, truthE, recoE, regionMask, (recoE - truthE) / truthE);
+    };
+    std::string regionHash = hashString(regionConfigText(regionConfig));
 
+    stageTimer timer("plotJetEnergyScale");
+    timer.start("read");
     // Loop over files
-    for (uint8_t jetRegion = 0; jetRegion < NUM_REGIONS; jetRegion++) {
-        if (!jets[jetRegion].loaded) {
+    for (std::list<std::string>::iterator iter = files.begin(); iter != files.end(); ++iter) {
+        if (cache.load(*iter, partial)) {
             continue;
         }
-        for (std::list<std::string>::iterator iter = jets[jetRegion].files.begin(); iter != jets[jetRegion].files.end(); ++iter) {
+        partial.reset();
+        // Create histograms
+        for (size_t jetRegion = 0; jetRegion < jets.size(); jetRegion++) {
+            truthEnergyFill[jetRegion].Reset();
+            normalizedEnergyFill[jetRegion].Reset();
+        }
+        if (isColumnCache(*iter)) {
+            fileKey = bootstrapFileKey(columnCacheSource(*iter));
+            uint64_t bytes = 0;
+            uint64_t rows = scanTruthJets(*iter, classifier.minEta(), classifier.maxEta(), fillEntry, bytes);
+            timer.count(rows, bytes);
+        }
+        else {
             TFile *inFile = TFile::Open((*iter).c_str());
+            if (inFile == nullptr) {
+                std::cerr << "Could not open file " << *iter << std::endl;
+                continue;
+            }
             TTree *jetTree = (TTree*) inFile->Get("ntp_truthjet");
             if (jetTree == nullptr) {
-                std::cout << "Could not find jet tree" << std::endl;
+                std::cerr << "Could not find jet tree" << std::endl;
+                inFile->Close();
+                continue;
             }
+            fileKey = bootstrapFileKey(*iter);
             float truthE, recoE;
             float pos[4];
             jetTree->SetBranchAddress("ge", &truthE);
             jetTree->SetBranchAddress("e", &recoE);
-            jetTree->SetBranchAddress("geta", &pos[0]);
-            jetTree->SetBranchAddress("gphi", &pos[1]);
-            jetTree->SetBranchAddress("eta", &pos[2]);
-            jetTree->SetBranchAddress("phi", &pos[3]);
-
-
-            // Create histograms
-            for (uint32_t i = 0; i < jetTree->GetEntries(); i++) {
-                jetTree->GetEntry(i);
-                if (r2 < calculateDistance(pos)) {
-                    continue;
+            if (addDerivedColumns(jetTree, *iter, regionHash, {"ge", "e"}, derivedDir)) {
+                // Precomputed matching distance, regions and response
+                float distance, response;
+                uint32_t regionMask;
+                jetTree->SetBranchAddress("dR2", &distance);
+                jetTree->SetBranchAddress("region", &regionMask);
+                jetTree->SetBranchAddress("response", &response);
+                for (uint32_t i = 0; i < jetTree->GetEntries(); i++) {
+                    jetTree->GetEntry(i);
+                    if (matching.Accept(distance) && regionMask != 0) {
+                        fillMatched(i, truthE, recoE, regionMask, response);
+                    }
                 }
-                // Filling Histograms
-                if (!std::isnan(recoE) && !std::isnan(truthE)) {
-                    jets[jetRegion].truthEnergyHist->Fill(truthE, recoE);
-                    jets[jetRegion].normalizedEnergyHist->Fill(truthE, (recoE - truthE) / truthE);
+            }
+            else {
+                jetTree->SetBranchAddress("geta", &pos[0]);
+                jetTree->SetBranchAddress("gphi", &pos[1]);
+                jetTree->SetBranchAddress("eta", &pos[2]);
+                jetTree->SetBranchAddress("phi", &pos[3]);
+                for (uint32_t i = 0; i < jetTree->GetEntries(); i++) {
+                    jetTree->GetEntry(i);
+                    fillEntry(i, truthE, recoE, pos, matching.Distance2(pos));
                 }
-                // std::cout << truthE << "\t" << recoE << std::endl;
-            
             }
+            timer.count(jetTree->GetEntries(), inFile->GetBytesRead());
             inFile->Close();
         }
+        for (size_t jetRegion = 0; jetRegion < jets.size(); jetRegion++) {
+            truthEnergyFill[jetRegion].AddTo(truthEnergyHist[jetRegion]);
+            normalizedEnergyFill[jetRegion].AddTo(normalizedEnergyHist[jetRegion]);
+        }
+        partial.merge();
+        cache.store(*iter, partial);
     }
-
+    cache.report();
     
+    timer.start("analysis");
+    // One pool for the fits of all regions and bootstrap replicas
+    enableParallelFits();
+    ROOT::TThreadExecutor fitPool;
     // Calculate energy scale and resolution
     // TProfile *profile = truthEnergyHist->ProfileX();
-    for (uint8_t jetRegion = 0; jetRegion < NUM_REGIONS; jetRegion++) {
-        if (!jets[jetRegion].loaded) {
-            continue;
-        }
+    for (size_t jetRegion = 0; jetRegion < jets.size(); jetRegion++) {
         jets[jetRegion].profile = jets[jetRegion].normalizedEnergyHist->ProfileX();
         jets[jetRegion].projection = jets[jetRegion].normalizedEnergyHist->ProjectionX();
         jets[jetRegion].profile->BuildOptions(0, 0, "s");
         jets[jetRegion].energy = (float*)malloc(bins_resolution * sizeof(float));
         jets[jetRegion].scale = (float*)malloc(bins_resolution * sizeof(float));
         jets[jetRegion].resolution = (float*)malloc(bins_resolution * sizeof(float));
+        jets[jetRegion].scaleError = (float*)malloc(bins_resolution * sizeof(float));
+        jets[jetRegion].resolutionError = (float*)malloc(bins_resolution * sizeof(float));
+        std::vector<sliceFit> fits;
+        if (fitResolution) {
+            fits = fitSlices(jets[jetRegion].normalizedEnergyHist, fitPool);
+        }
+
+        // Errors are the spread of the same estimate over the bootstrap replicas
+        bootstrapSpread scaleSpread(bins_resolution + 1);
+        bootstrapSpread resolutionSpread(bins_resolution + 1);
+        if (fitResolution) {
+            for (int replica = 0; replica < bootstrapReplicas; replica++) {
+                TH2 *replicaHist = (TH2*) bootstrapReplica(jets[jetRegion].normalizedEnergyHist, jets[jetRegion].normalizedEnergyBootstrap, replica);
+                std::vector<sliceFit> replicaFits = fitSlices(replicaHist, fitPool);
+                for (uint32_t i = 1; i <= bins_resolution; i++) {
+                    if (replicaFits[i - 1].converged) {
+                        scaleSpread.add(i, replicaFits[i - 1].scale);
+                        resolutionSpread.add(i, replicaFits[i - 1].resolution);
+                    }
+                }
+                delete replicaHist;
+            }
+        }
+        else {
+            bootstrapProfileSpread(jets[jetRegion].normalizedEnergyHist, jets[jetRegion].normalizedEnergyBootstrap, scaleSpread, resolutionSpread);
+        }
         uint32_t fullBins = 0;
         for (uint32_t i = 1; i <= bins_resolution; i++) {
             if (jets[jetRegion].projection->GetBinContent(i) == 0) {
@@ -160,18 +264,43 @@ void plotJetEnergyScale(std::string centralFileList = "", std::string forwardFil
             }
             jets[jetRegion].energy[fullBins] = jets[jetRegion].profile->GetBinCenter(i);
             // scale[fullBins] = (profile->GetBinContent(i) - profile->GetBinCenter(i)) / profile->GetBinCenter(i);
-            jets[jetRegion].scale[fullBins] = jets[jetRegion].profile->GetBinContent(i);
-            jets[jetRegion].resolution[fullBins] = jets[jetRegion].profile->GetBinError(i);
+            if (fitResolution) {
+                if (!fits[i - 1].converged) {
+                    continue;
+                }
+                jets[jetRegion].scale[fullBins] = fits[i - 1].scale;
+                jets[jetRegion].resolution[fullBins] = fits[i - 1].resolution;
+            }
+            else {
+                jets[jetRegion].scale[fullBins] = jets[jetRegion].profile->GetBinContent(i);
+                jets[jetRegion].resolution[fullBins] = jets[jetRegion].profile->GetBinError(i);
+            }
+            jets[jetRegion].scaleError[fullBins] = scaleSpread.error(i);
+            jets[jetRegion].resolutionError[fullBins] = resolutionSpread.error(i);
+            double entries = jets[jetRegion].projection->GetBinContent(i);
+            summary.add(jets[jetRegion].descriptiveName, "energyScale", i, jets[jetRegion].energy[fullBins],
+                        jets[jetRegion].scale[fullBins], jets[jetRegion].scaleError[fullBins], entries);
+            summary.add(jets[jetRegion].descriptiveName, "energyResolution", i, jets[jetRegion].energy[fullBins],
+                        jets[jetRegion].resolution[fullBins], jets[jetRegion].resolutionError[fullBins], entries);
+            std::cout << jets[jetRegion].descriptiveName << "\t" << jets[jetRegion].energy[fullBins] << " GeV\tscale "
+                      << jets[jetRegion].scale[fullBins] << " +- " << jets[jetRegion].scaleError[fullBins] << "\tresolution "
+                      << jets[jetRegion].resolution[fullBins] << " +- " << jets[jetRegion].resolutionError[fullBins] << std::endl;
             fullBins++;
             // std::cout << projection->GetBinContent(i) << "\t" << energy[i] << "\t" << scale[i] << std::endl;
         }
         jets[jetRegion].fullBins = fullBins;
     }
+    summary.write();
 
     // gStyle->SetPadLeftMargin(0.15);
 
 
     // Plotting
+    renderQueue renderer(formats);
+    if (!renderer.enabled()) {
+        return;
+    }
+    timer.start("render");
     gStyle->SetPadRightMargin(0.12);
     gStyle->SetPadLeftMargin(0.12);
     gStyle->SetPadTopMargin(0.12);
@@ -182,11 +311,8 @@ void plotJetEnergyScale(std::string centralFileList = "", std::string forwardFil
     jetEnergy->cd(1);
     TMultiGraph *jetScale = new TMultiGraph("jet_energy_scale", "Jet Energy Scale");
     TLegend *jetScaleLegend = new TLegend(0.65, 0.8, 0.87, 0.87);
-    for (uint8_t jetRegion = 0; jetRegion < NUM_REGIONS; jetRegion++) {
-        if (!jets[jetRegion].loaded) {
-            continue;
-        }
-        jets[jetRegion].jetScale = new TGraph(jets[jetRegion].fullBins, jets[jetRegion].energy, jets[jetRegion].scale);
+    for (size_t jetRegion = 0; jetRegion < jets.size(); jetRegion++) {
+        jets[jetRegion].jetScale = new TGraphErrors(jets[jetRegion].fullBins, jets[jetRegion].energy, jets[jetRegion].scale, nullptr, jets[jetRegion].scaleError);
         jets[jetRegion].jetScale->SetMarkerColor(jets[jetRegion].color);
         jets[jetRegion].jetScale->SetMarkerStyle(jets[jetRegion].marker);
         jets[jetRegion].jetScale->SetMarkerSize(jets[jetRegion].markerSize);
@@ -195,7 +321,7 @@ void plotJetEnergyScale(std::string centralFileList = "", std::string forwardFil
     }
     jetScale->Draw("ALP");
     jetScale->GetXaxis()->SetTitle("Energy");
-    jetScale->GetYaxis()->SetTitle("Scale (Mean((reco-truth)/truth))");
+    jetScale->GetYaxis()->SetTitle(fitResolution ? "Scale (Gaussian #mu((reco-truth)/truth))" : "Scale (Mean((reco-truth)/truth))");
     jetScale->SetTitle("Jet Energy Scale");
     jetScaleLegend->Draw();
 
@@ -204,11 +330,8 @@ void plotJetEnergyScale(std::string centralFileList = "", std::string forwardFil
     jetEnergy->cd(2);
     TMultiGraph *jetResolution = new TMultiGraph("jet_energy_resolution", "Jet Energy Resolution");
     TLegend *jetResolutionLegend = new TLegend(0.65, 0.8, 0.87, 0.87);
-    for (uint8_t jetRegion = 0; jetRegion < NUM_REGIONS; jetRegion++) {
-        if (!jets[jetRegion].loaded) {
-            continue;
-        }
-        jets[jetRegion].jetResolution = new TGraph(jets[jetRegion].fullBins, jets[jetRegion].energy, jets[jetRegion].resolution);
+    for (size_t jetRegion = 0; jetRegion < jets.size(); jetRegion++) {
+        jets[jetRegion].jetResolution = new TGraphErrors(jets[jetRegion].fullBins, jets[jetRegion].energy, jets[jetRegion].resolution, nullptr, jets[jetRegion].resolutionError);
         jets[jetRegion].jetResolution->SetMarkerColor(jets[jetRegion].color);
         jets[jetRegion].jetResolution->SetMarkerStyle(jets[jetRegion].marker);
         jets[jetRegion].jetResolution->SetMarkerSize(jets[jetRegion].markerSize);
@@ -217,21 +340,17 @@ void plotJetEnergyScale(std::string centralFileList = "", std::string forwardFil
     }
     jetResolution->Draw("ALP");
     jetResolution->GetXaxis()->SetTitle("Energy");
-    jetResolution->GetYaxis()->SetTitle("Resolution (RMS((reco-truth)/truth))"); 
+    jetResolution->GetYaxis()->SetTitle(fitResolution ? "Resolution (Gaussian #sigma((reco-truth)/truth))" : "Resolution (RMS((reco-truth)/truth))");
     jetResolution->SetTitle("Jet Energy Resolution");
     jetResolutionLegend->Draw();
 
-    jetEnergy->SaveAs("canvas.png");
-    jetEnergy->SaveAs("canvas.c");
+    renderer.add(jetEnergy, "canvas");
 
 
     TCanvas *sliceCanvas = new TCanvas("slice", "", 500, 500);
     THStack *sliceStack = new THStack();
     TLegend *sliceLegend = new TLegend(0.65, 0.8, 0.87, 0.87);
-    for (uint8_t jetRegion = 0; jetRegion < NUM_REGIONS; jetRegion++) {
-        if (!jets[jetRegion].loaded) {
-            continue;
-        }
+    for (size_t jetRegion = 0; jetRegion < jets.size(); jetRegion++) {
         jets[jetRegion].slice = jets[jetRegion].normalizedEnergyHist->ProjectionY(Form("%s slice", jets[jetRegion].descriptiveName.c_str()), 
                                                                                   slice_energy, slice_energy);
         jets[jetRegion].slice->SetLineColor(jets[jetRegion].color);
@@ -243,8 +362,8 @@ void plotJetEnergyScale(std::string centralFileList = "", std::string forwardFil
     sliceStack->GetXaxis()->SetTitle("(reco - truth) / truth");
     sliceStack->GetYaxis()->SetTitle("Counts");
     sliceLegend->Draw();
-    sliceCanvas->SaveAs("canvas2.png");
-    sliceCanvas->SaveAs("canvas2.c");
+    renderer.add(sliceCanvas, "canvas2");
+    renderer.render();
 
 
 
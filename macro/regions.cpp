@@ -0,0 +1,145 @@
+#ifndef REGIONS_CPP
+#define REGIONS_CPP
+
+#include <TROOT.h>
+
+#include <string>
+#include <vector>
+#include <map>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// Jet regions
+// Regions are read from a whitespace separated table, one region per line:
+//   name minEta maxEta minEnergy maxEnergy color secondaryColor marker markerSize
+// Colors are numbers or ROOT names with an optional offset (kGreen+2).  Ranges
+// are [min, max) in truth eta and truth energy, and regions may overlap.
+
+const int maxRegions = 32;  // one bit per region in the lookup
+
+class jetData {
+    public:
+        std::string descriptiveName;
+        float minEta;
+        float maxEta;
+        float minEnergy;
+        float maxEnergy;
+        int color;
+        int secondaryColor;
+        int marker;
+        float markerSize;
+};
+
+int parseColor(const std::string &text) {
+    static const std::map<std::string, int> names = {
+        {"kBlack", kBlack}, {"kRed", kRed}, {"kGreen", kGreen}, {"kBlue", kBlue}, {"kYellow", kYellow},
+        {"kMagenta", kMagenta}, {"kCyan", kCyan}, {"kOrange", kOrange}, {"kViolet", kViolet}, {"kGray", kGray}
+    };
+    size_t split = text.find_first_of("+-", 1);
+    std::string name = text.substr(0, split);
+    int offset = split == std::string::npos ? 0 : std::stoi(text.substr(split));
+    std::map<std::string, int>::const_iterator found = names.find(name);
+    if (found == names.end()) {
+        return std::stoi(text);
+    }
+    return found->second + offset;
+}
+
+// Read the region table into regions, returns the number of regions
+template <class T>
+int loadRegions(const std::string &regionConfig, std::vector<T> &regions) {
+    std::ifstream config(regionConfig);
+    if (!config) {
+        std::cerr << "Could not open region config " << regionConfig << std::endl;
+        return 0;
+    }
+    std::string line;
+    while (std::getline(config, line)) {
+        line = line.substr(0, line.find('#'));
+        std::istringstream fields(line);
+        T region;
+        std::string color, secondaryColor;
+        if (!(fields >> region.descriptiveName >> region.minEta >> region.maxEta >> region.minEnergy >> region.maxEnergy
+                     >> color >> secondaryColor >> region.marker >> region.markerSize)) {
+            continue;
+        }
+        if ((int)regions.size() == maxRegions) {
+            std::cerr << "Only " << maxRegions << " regions are supported, ignoring " << region.descriptiveName << std::endl;
+            continue;
+        }
+        region.color = parseColor(color);
+        region.secondaryColor = parseColor(secondaryColor);
+        regions.push_back(region);
+    }
+    return regions.size();
+}
+
+// Text of the region table, for configuration hashes
+std::string regionConfigText(const std::string &regionConfig) {
+    std::ifstream config(regionConfig);
+    std::stringstream text;
+    text << config.rdbuf();
+    return text.str();
+}
+
+// Precomputed classification of (truth eta, truth energy) into a bitmask of regions.
+// The grid edges are the union of all region boundaries, so every cell is either
+// fully inside or fully outside each region and the lookup is exact.
+class regionClassifier {
+    public:
+        std::vector<float> etaEdges;
+        std::vector<float> energyEdges;
+        std::vector<uint32_t> masks;    // (etaEdges.size() + 1) * (energyEdges.size() + 1)
+
+        template <class T>
+        regionClassifier(const std::vector<T> &regions) {
+            for (const T &region : regions) {
+                etaEdges.push_back(region.minEta);
+                etaEdges.push_back(region.maxEta);
+                energyEdges.push_back(region.minEnergy);
+                energyEdges.push_back(region.maxEnergy);
+            }
+            uniqueSort(etaEdges);
+            uniqueSort(energyEdges);
+            int etaCells = etaEdges.size() + 1;
+            int energyCells = energyEdges.size() + 1;
+            masks.assign(etaCells * energyCells, 0);
+            for (int etaCell = 1; etaCell < etaCells - 1; etaCell++) {
+                for (int energyCell = 1; energyCell < energyCells - 1; energyCell++) {
+                    float eta = etaEdges[etaCell - 1];          // lower edge of the cell
+                    float energy = energyEdges[energyCell - 1];
+                    for (size_t i = 0; i < regions.size(); i++) {
+                        if (eta >= regions[i].minEta && eta < regions[i].maxEta &&
+                            energy >= regions[i].minEnergy && energy < regions[i].maxEnergy) {
+                            masks[etaCell * energyCells + energyCell] |= 1u << i;
+                        }
+                    }
+                }
+            }
+        }
+
+        uint32_t classify(float eta, float energy) const {
+            if (std::isnan(eta) || std::isnan(energy)) {
+                return 0;
+            }
+            int etaCell = std::upper_bound(etaEdges.begin(), etaEdges.end(), eta) - etaEdges.begin();
+            int energyCell = std::upper_bound(energyEdges.begin(), energyEdges.end(), energy) - energyEdges.begin();
+            return masks[etaCell * (energyEdges.size() + 1) + energyCell];
+        }
+
+        // Truth eta range covered by any region
+        float minEta() const { return etaEdges.empty() ? std::numeric_limits<float>::infinity() : etaEdges.front(); }
+        float maxEta() const { return etaEdges.empty() ? -std::numeric_limits<float>::infinity() : etaEdges.back(); }
+
+    private:
+        static void uniqueSort(std::vector<float> &edges) {
+            std::sort(edges.begin(), edges.end());
+            edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+        }
+};
+
+#endif // REGIONS_CPP
@@ -0,0 +1,93 @@
+#ifndef RENDER_CPP
+#define RENDER_CPP
+
+#include <TROOT.h>
+#include <TCanvas.h>
+#include <ROOT/TProcessExecutor.hxx>
+
+#include <string>
+#include <vector>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+
+// Plot rendering
+// Canvases are queued with the base name of their output files and saved once
+// all of them are drawn, in ROOT batch mode and only in the requested formats
+// (comma separated extensions, "png,c").  Independent canvases are written in
+// forked worker processes so slow formats don't serialize the run.  An empty
+// format list skips plotting altogether.
+
+const std::string defaultFormats("png,c");
+
+// Split "png,c" into {"png", "c"}
+std::vector<std::string> renderFormats(const std::string &formats) {
+    std::vector<std::string> list;
+    std::stringstream stream(formats);
+    std::string format;
+    while (std::getline(stream, format, ',')) {
+        format.erase(std::remove(format.begin(), format.end(), ' '), format.end());
+        if (format != "") {
+            list.push_back(format);
+        }
+    }
+    return list;
+}
+
+class renderQueue {
+    public:
+        std::vector<std::string> formats;
+        std::vector<TCanvas*> canvases;
+        std::vector<std::string> names;
+
+        // Switches to batch mode before any canvas is made, if anything is to be drawn
+        renderQueue(const std::string &formatList) : formats(renderFormats(formatList)) {
+            if (enabled()) {
+                gROOT->SetBatch(true);
+            }
+        }
+
+        bool enabled() const { return !formats.empty(); }
+
+        void add(TCanvas *canvas, const std::string &name) {
+            canvases.push_back(canvas);
+            names.push_back(name);
+        }
+
+        // Save every queued canvas in every format, one worker process per canvas
+        void render(unsigned nProcesses = 0) {
+            if (!enabled() || canvases.empty()) {
+                return;
+            }
+            std::vector<unsigned> indices(canvases.size());
+            for (unsigned i = 0; i < indices.size(); i++) {
+                indices[i] = i;
+            }
+            if (canvases.size() == 1) {  // not worth a fork
+                save(0);
+            } else {
+                ROOT::TProcessExecutor pool(std::min<unsigned>(nProcesses == 0 ? canvases.size() : nProcesses, canvases.size()));
+                pool.Map([this](unsigned i) { save(i); return 0; }, indices);
+            }
+            for (unsigned i = 0; i < canvases.size(); i++) {
+                std::cout << "rendered " << names[i] << " (" << formatsText() << ")" << std::endl;
+            }
+        }
+
+    private:
+        void save(unsigned i) {
+            for (const std::string &format : formats) {
+                canvases[i]->SaveAs((names[i] + "." + format).c_str());
+            }
+        }
+
+        std::string formatsText() const {
+            std::string text;
+            for (const std::string &format : formats) {
+                text += (text == "" ? "" : ",") + format;
+            }
+            return text;
+        }
+};
+
+#endif // RENDER_CPP
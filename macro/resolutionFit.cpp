@@ -0,0 +1,126 @@
+#ifndef RESOLUTIONFIT_CPP
+#define RESOLUTIONFIT_CPP
+
+#include <TROOT.h>
+#include <TH1D.h>
+#include <TH2.h>
+#include <TF1.h>
+#include <TFitResult.h>
+#include <Math/MinimizerOptions.h>
+#include <ROOT/TThreadExecutor.hxx>
+
+#include <string>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+// Gaussian fit resolution engine
+// Every x slice of a response histogram (x = truth, y = response) is fit with a
+// gaussian, iterating the fit range to +-window sigma around the last result.
+// Slices are split into contiguous chunks which are fit in parallel; inside a
+// chunk each slice starts from the previous slice's result, so neighbouring
+// slices converge in one or two iterations.
+
+const int fitIterations = 4;
+const double fitWindow = 2;          // fit range in sigma
+const double fitTolerance = 0.01;    // relative change in sigma to stop iterating
+const int fitMinEntries = 10;
+
+class sliceFit {
+    public:
+        double center = 0;
+        double entries = 0;
+        double scale = 0;
+        double scaleError = 0;
+        double resolution = 0;
+        double resolutionError = 0;
+        bool converged = false;
+};
+
+// Iterative +-window sigma gaussian fit of one slice, seeded with mean and sigma
+void fitSlice(TH1D *slice, TF1 &gaus, double mean, double sigma, sliceFit &result) {
+    result.entries = slice->GetEntries();
+    if (result.entries < fitMinEntries || !(sigma > 0)) {
+        return;
+    }
+    for (int iteration = 0; iteration < fitIterations; iteration++) {
+        double lo = mean - fitWindow * sigma;
+        double hi = mean + fitWindow * sigma;
+        gaus.SetRange(lo, hi);
+        gaus.SetParameters(slice->GetBinContent(slice->GetXaxis()->FindFixBin(mean)), mean, sigma);
+        int status = slice->Fit(&gaus, "QNR0");
+        if (status != 0 || !(gaus.GetParameter(2) != 0)) {
+            return;
+        }
+        double lastSigma = sigma;
+        mean = gaus.GetParameter(1);
+        sigma = std::abs(gaus.GetParameter(2));
+        result.scale = mean;
+        result.scaleError = gaus.GetParError(1);
+        result.resolution = sigma;
+        result.resolutionError = gaus.GetParError(2);
+        result.converged = true;
+        if (std::abs(sigma - lastSigma) < fitTolerance * lastSigma) {
+            break;
+        }
+    }
+}
+
+// TMinuit is not thread safe; call before the pool passed to fitSlices is made
+void enableParallelFits() {
+    ROOT::EnableThreadSafety();
+    ROOT::Math::MinimizerOptions::SetDefaultMinimizer("Minuit2");
+}
+
+// Fit all x slices of response with the threads of pool, returns one sliceFit
+// per x bin.  Macros fitting many histograms (bootstrap replicas) share one pool.
+std::vector<sliceFit> fitSlices(TH2 *response, ROOT::TThreadExecutor &pool) {
+    int nBins = response->GetNbinsX();
+    std::vector<sliceFit> fits(nBins);
+
+    // Projections touch gDirectory, so they are made up front on this thread
+    bool addDirectory = TH1::AddDirectoryStatus();
+    TH1::AddDirectory(false);
+    std::vector<TH1D*> slices(nBins);
+    for (int i = 0; i < nBins; i++) {
+        slices[i] = response->ProjectionY(Form("%s_slice_%d", response->GetName(), i), i + 1, i + 1);
+        fits[i].center = response->GetXaxis()->GetBinCenter(i + 1);
+    }
+    TH1::AddDirectory(addDirectory);
+
+    unsigned nChunks = std::min<unsigned>(std::max<unsigned>(pool.GetPoolSize(), 1), nBins);
+    std::vector<unsigned> chunks(nChunks);
+    for (unsigned chunk = 0; chunk < nChunks; chunk++) {
+        chunks[chunk] = chunk;
+    }
+    pool.Foreach([&](unsigned chunk) {
+        int first = chunk * nBins / nChunks;
+        int last = (chunk + 1) * nBins / nChunks;
+        std::string name = std::string(response->GetName()) + "_gaus_" + std::to_string(chunk);
+        TF1 gaus(name.c_str(), "gaus", 0, 1, TF1::EAddToList::kNo);
+        const sliceFit *previous = nullptr;
+        for (int i = first; i < last; i++) {
+            if (previous != nullptr && previous->converged) {
+                fitSlice(slices[i], gaus, previous->scale, previous->resolution, fits[i]);
+            }
+            if (!fits[i].converged) {   // first slice, or the neighbour was a bad seed
+                fitSlice(slices[i], gaus, slices[i]->GetMean(), slices[i]->GetStdDev(), fits[i]);
+            }
+            previous = &fits[i];
+        }
+    }, chunks);
+
+    for (TH1D *slice : slices) {
+        delete slice;
+    }
+    return fits;
+}
+
+// Single histogram version with its own pool
+std::vector<sliceFit> fitSlices(TH2 *response, unsigned nThreads = 0) {
+    enableParallelFits();
+    ROOT::TThreadExecutor pool(nThreads);
+    return fitSlices(response, pool);
+}
+
+#endif // RESOLUTIONFIT_CPP
@@ -0,0 +1,70 @@
+#ifndef STAGETIMER_CPP
+#define STAGETIMER_CPP
+
+#include <TROOT.h>
+#include <TStopwatch.h>
+
+#include <string>
+#include <iostream>
+
+#include <sys/resource.h>
+
+// Stage timing
+// A macro is split into named stages (read, analysis, render); each prints one
+// line when it ends, which bench/runBenchmark.sh collects:
+//   stage <macro> <stage> <seconds> <entries> <bytes> <entries/s> <MB/s> <peak RSS MB> <child peak RSS MB>
+// The kernel only keeps high-water marks, so both RSS columns are the peak of
+// the whole run up to the end of the stage, not of the stage alone.  The child
+// column is the largest waited-for child, e.g. the render workers.
+
+// Peak resident set size so far of this process (RUSAGE_SELF) or of its
+// largest terminated child (RUSAGE_CHILDREN), in MB
+double peakRSS(int who = RUSAGE_SELF) {
+    struct rusage usage;
+    getrusage(who, &usage);
+    return usage.ru_maxrss / 1024.;     // kB on Linux
+}
+
+class stageTimer {
+    public:
+        std::string macro;
+        std::string stage;
+        TStopwatch watch;
+        uint64_t entries = 0;
+        uint64_t bytes = 0;
+
+        stageTimer(const std::string &macroName) : macro(macroName) {}
+
+        // Ends the running stage, if any, and starts the next
+        void start(const std::string &name) {
+            stop();
+            stage = name;
+            entries = 0;
+            bytes = 0;
+            watch.Start(true);
+        }
+
+        void count(uint64_t nEntries, uint64_t nBytes = 0) {
+            entries += nEntries;
+            bytes += nBytes;
+        }
+
+        void stop() {
+            if (stage == "") {
+                return;
+            }
+            watch.Stop();
+            double seconds = watch.RealTime();
+            double rate = seconds > 0 ? entries / seconds : 0;
+            double throughput = seconds > 0 ? bytes / seconds / 1e6 : 0;
+            std::cout << "stage " << macro << " " << stage << " " << seconds << " " << entries << " " << bytes << " "
+                      << rate << " " << throughput << " " << peakRSS() << " " << peakRSS(RUSAGE_CHILDREN) << std::endl;
+            stage = "";
+        }
+
+        ~stageTimer() {
+            stop();
+        }
+};
+
+#endif // STAGETIMER_CPP
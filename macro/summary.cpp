@@ -0,0 +1,71 @@
+#ifndef SUMMARY_CPP
+#define SUMMARY_CPP
+
+#include <TROOT.h>
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <limits>
+
+// Summary output
+// Per bin results of a macro as CSV, one row per (region, quantity, bin):
+//   macro,region,quantity,bin,center,value,error,entries
+// preceded by comment lines with the format version and the configuration hash
+// of the run (the same hash keys the partial histogram cache), so two
+// productions can be compared with diff or any CSV reader.
+
+class summaryRow {
+    public:
+        std::string region;
+        std::string quantity;
+        int bin;
+        double center;
+        double value;
+        double error;
+        double entries;
+};
+
+class summaryWriter {
+    public:
+        std::string path;           // empty disables the summary
+        std::string macro;
+        std::string configHash;
+        std::vector<summaryRow> rows;
+
+        summaryWriter(const std::string &summaryPath, const std::string &macroName, const std::string &hash)
+            : path(summaryPath), macro(macroName), configHash(hash) {}
+
+        bool enabled() const { return !path.empty(); }
+
+        void add(const std::string &region, const std::string &quantity, int bin, double center,
+                 double value, double error, double entries) {
+            if (enabled()) {
+                rows.push_back({region, quantity, bin, center, value, error, entries});
+            }
+        }
+
+        bool write() const {
+            if (!enabled()) {
+                return true;
+            }
+            std::ofstream out(path);
+            if (!out) {
+                std::cerr << "Could not write summary " << path << std::endl;
+                return false;
+            }
+            out.precision(std::numeric_limits<float>::max_digits10);
+            out << "# jet-summary v1" << std::endl;
+            out << "# config " << configHash << std::endl;
+            out << "macro,region,quantity,bin,center,value,error,entries" << std::endl;
+            for (const summaryRow &row : rows) {
+                out << macro << "," << row.region << "," << row.quantity << "," << row.bin << "," << row.center << ","
+                    << row.value << "," << row.error << "," << row.entries << "\n";
+            }
+            std::cout << "wrote " << rows.size() << " summary rows to " << path << std::endl;
+            return true;
+        }
+};
+
+#endif // SUMMARY_CPP
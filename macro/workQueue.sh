@@ -0,0 +1,160 @@
+#!/bin/bash
+# File based work queue for running jobs on many nodes
+#
+# A queue is a directory on a filesystem every node sees.  Shards (file lists)
+# move between subdirectories with mv, which is an atomic rename, so any number
+# of workers on any number of nodes can claim them without a central service:
+#   pending/<shard>               waiting to be claimed
+#   running/<shard>@<host>.<pid>  claimed; the worker touches it as a heartbeat
+#   done/<shard>, failed/<shard>  finished, failed after MAX_ATTEMPTS tries
+#   output/<shard>/<attempt>/     working directory of each attempt, so a
+#                                 worker whose claim expired cannot overwrite
+#                                 the files of the one that took over
+#   output/<shard>/done           link to the attempt that finished the shard
+#   logs/<shard>.<attempt>.log    output of each attempt
+# Shards whose heartbeat is older than TIMEOUT seconds are moved back to
+# pending by whichever worker notices first.
+#
+# usage: workQueue.sh init <queueDir> <fileList> [filesPerShard]
+#        workQueue.sh work <queueDir> <command...>
+#        workQueue.sh status <queueDir>
+# In the command {} is the shard's file list, {file} its first file and
+# {name} the shard name; paths should be absolute since the command runs in
+# output/<shard>/<attempt>/, e.g.
+#   workQueue.sh work q root -b -q "$PWD/jetEfficiency.cpp+(\"{}\")"
+#   workQueue.sh work q root -b -q "$PWD/Fun4All_JetEnergyResolution.c(0, \"{file}\")"
+#   HEARTBEAT, TIMEOUT, MAX_ATTEMPTS override the defaults
+
+set -e
+
+HEARTBEAT=${HEARTBEAT:-60}
+TIMEOUT=${TIMEOUT:-600}
+MAX_ATTEMPTS=${MAX_ATTEMPTS:-3}
+
+usage() {
+    sed -n '/^# usage:/,/^$/p' "$0" | sed 's/^# \{0,1\}//'
+    exit 1
+}
+
+# Split fileList into shards of filesPerShard files
+init() {
+    local queue=$1 fileList=$2 perShard=${3:-1}
+    [ -f "$fileList" ] || { echo "no file list $fileList"; exit 1; }
+    mkdir -p "$queue"/{pending,running,done,failed,output,logs}
+    local prefix
+    prefix=$(basename "$fileList" .list)
+    grep -v '^[[:space:]]*$' "$fileList" | split -d -a 5 -l "$perShard" - "$queue/pending/$prefix."
+    echo "queued $(ls "$queue/pending" | wc -l) shards in $queue"
+}
+
+# Move running shards with an expired heartbeat back to pending
+requeue() {
+    local queue=$1 now claim shard
+    now=$(date +%s)
+    for claim in "$queue"/running/*@*; do
+        [ -e "$claim" ] || continue
+        if (( now - $(stat -c %Y "$claim" 2>/dev/null || echo "$now") > TIMEOUT )); then
+            shard=$(basename "${claim%@*}")
+            mv "$claim" "$queue/pending/$shard" 2>/dev/null && echo "requeued $shard, heartbeat expired" || true
+        fi
+    done
+}
+
+# Claim one pending shard, prints the claim path
+claim() {
+    local queue=$1 worker=$2 shard
+    for shard in "$queue"/pending/*; do
+        [ -e "$shard" ] || continue
+        # mv keeps the mtime, touch before and after so requeue never sees a
+        # fresh claim as expired
+        touch -c "$shard"
+        if mv "$shard" "$queue/running/$(basename "$shard")@$worker" 2>/dev/null; then
+            touch -c "$queue/running/$(basename "$shard")@$worker"
+            echo "$queue/running/$(basename "$shard")@$worker"
+            return 0
+        fi
+    done
+    return 1
+}
+
+# Run one claimed shard, keeping its heartbeat while the command runs
+run() {
+    local queue=$1 claimPath=$2
+    shift 2
+    local shard attempts log output status heartbeatPid
+    shard=$(basename "${claimPath%@*}")
+    attempts=$(( $(cat "$queue/logs/$shard.attempts" 2>/dev/null || echo 0) + 1 ))
+    echo "$attempts" > "$queue/logs/$shard.attempts"
+    log=$queue/logs/$shard.$attempts.log
+    output=$queue/output/$shard/$attempts
+    mkdir -p "$output"
+
+    local args=() arg
+    for arg in "$@"; do
+        arg=${arg//\{file\}/$(head -n 1 "$claimPath")}
+        arg=${arg//\{name\}/$shard}
+        args+=("${arg//\{\}/$output/$shard.list}")
+    done
+    cp "$claimPath" "$output/$shard.list"
+
+    # touch -c so a shard requeued by another worker is not recreated
+    ( while sleep "$HEARTBEAT"; do touch -c "$claimPath"; done ) &
+    heartbeatPid=$!
+    echo "$(date) $WORKER running $shard (attempt $attempts)"
+    status=0
+    ( cd "$output" && "${args[@]}" ) > "$log" 2>&1 || status=$?
+    kill "$heartbeatPid" 2>/dev/null || true
+    wait "$heartbeatPid" 2>/dev/null || true
+
+    if [ $status == 0 ]; then
+        if mv "$claimPath" "$queue/done/$shard" 2>/dev/null; then
+            ln -sfn "$attempts" "$queue/output/$shard/done"
+            echo "$(date) $WORKER finished $shard"
+        else
+            echo "$(date) $WORKER $shard finished after its claim expired, ignoring $output"
+        fi
+    elif (( attempts >= MAX_ATTEMPTS )); then
+        mv "$claimPath" "$queue/failed/$shard" 2>/dev/null || true
+        echo "$(date) $WORKER $shard failed $attempts times, see $log"
+    else
+        mv "$claimPath" "$queue/pending/$shard" 2>/dev/null || true
+        echo "$(date) $WORKER $shard failed with $status, requeued"
+    fi
+}
+
+work() {
+    local queue
+    queue=$(cd "$1" && pwd)
+    shift
+    [ -d "$queue/pending" ] || { echo "no queue in $queue"; exit 1; }
+    [ $# -gt 0 ] || usage
+    WORKER=$(hostname -s).$$
+    local claimPath
+    while true; do
+        requeue "$queue"
+        if claimPath=$(claim "$queue" "$WORKER"); then
+            run "$queue" "$claimPath" "$@"
+        elif compgen -G "$queue/running/*" > /dev/null; then
+            sleep "$HEARTBEAT"   # others still running, their shards may come back
+        else
+            break
+        fi
+    done
+    echo "$(date) $WORKER queue empty"
+}
+
+status() {
+    local queue=$1 state
+    for state in pending running done failed; do
+        printf "%-8s %d\n" "$state" "$(ls "$queue/$state" 2>/dev/null | wc -l)"
+    done
+}
+
+COMMAND=$1
+shift || usage
+case "$COMMAND" in
+    init) [ $# -ge 2 ] || usage; init "$@" ;;
+    work) [ $# -ge 2 ] || usage; work "$@" ;;
+    status) [ $# -ge 1 ] || usage; status "$@" ;;
+    *) usage ;;
+esac
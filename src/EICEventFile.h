@@ -0,0 +1,224 @@
+// Tell emacs that this is a C++ source
+//  -*- C++ -*-.
+#ifndef EICEVENTFILE_H
+#define EICEVENTFILE_H
+
+// Indexed binary copy of EIC-smear generator events, written once by
+// macro/convertEIC.cpp and read by ReadEICCache in every job.  Only what the
+// Fun4All generator input uses is kept: the two beam particles and the final
+// state (status 1) particles.  The file is memory mapped and every event is
+// found through the index, so a shard starts at its first event directly.
+// No ROOT or Fun4All dependencies.
+//
+// Layout, native byte order:
+//   header   magic "EICBIN01", uint64 nEvents, uint64 indexOffset
+//   events   int32 eventNumber, uint32 nParticles, EICParticle[nParticles]
+//   index    uint64 offset of every event, 8 byte aligned
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+const char kEICEventMagic[8] = {'E', 'I', 'C', 'B', 'I', 'N', '0', '1'};
+
+struct EICParticle
+{
+  int32_t pid;
+  int32_t status;  ///< eic-smear status; beams are the first two particles of an event
+  float px, py, pz, e, m;
+};
+
+struct EICEventFileHeader
+{
+  char magic[8];
+  uint64_t nEvents;
+  uint64_t indexOffset;
+};
+
+struct EICEventHeader
+{
+  int32_t eventNumber;
+  uint32_t nParticles;
+};
+
+/// Writes events one at a time to <path>.tmp, the index on Close, which
+/// renames the file to path.  A writer destroyed without Close or with a
+/// failed write leaves no file behind.
+class EICEventWriter
+{
+ public:
+  explicit EICEventWriter(const std::string &path)
+    : path(path)
+    , tmpPath(path + ".tmp")
+  {
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, kEICEventMagic, sizeof(header.magic));
+    file = std::fopen(tmpPath.c_str(), "wb");
+    if (file)
+    {
+      Write(&header, sizeof(header), 1);
+    }
+  }
+
+  ~EICEventWriter()
+  {
+    if (file)
+    {
+      std::fclose(file);
+      std::remove(tmpPath.c_str());
+    }
+  }
+
+  EICEventWriter(const EICEventWriter &) = delete;
+  EICEventWriter &operator=(const EICEventWriter &) = delete;
+
+  bool IsOpen() const { return file != nullptr; }
+
+  void Write(int32_t eventNumber, const std::vector<EICParticle> &particles)
+  {
+    long offset = std::ftell(file);
+    good = good && offset >= 0;
+    offsets.push_back(offset);
+    EICEventHeader event = {eventNumber, static_cast<uint32_t>(particles.size())};
+    Write(&event, sizeof(event), 1);
+    Write(particles.data(), sizeof(EICParticle), particles.size());
+  }
+
+  /// Write the index and the final header and move the file in place.  False
+  /// if any write failed (e.g. a full disk); the incomplete file is then removed.
+  bool Close()
+  {
+    if (!file)
+    {
+      return false;
+    }
+    static const char zeros[8] = {0};
+    long offset = std::ftell(file);
+    Write(zeros, 1, (8 - offset % 8) % 8);
+    header.nEvents = offsets.size();
+    header.indexOffset = std::ftell(file);
+    Write(offsets.data(), sizeof(uint64_t), offsets.size());
+    good = good && offset >= 0 && std::fseek(file, 0, SEEK_SET) == 0;
+    Write(&header, sizeof(header), 1);
+    good = std::fclose(file) == 0 && good;
+    file = nullptr;
+    good = good && std::rename(tmpPath.c_str(), path.c_str()) == 0;
+    if (!good)
+    {
+      std::remove(tmpPath.c_str());
+    }
+    return good;
+  }
+
+ private:
+  void Write(const void *data, std::size_t size, std::size_t n)
+  {
+    if (n > 0 && std::fwrite(data, size, n, file) != n)
+    {
+      good = false;
+    }
+  }
+
+  std::string path;
+  std::string tmpPath;
+  FILE *file = nullptr;
+  bool good = true;
+  EICEventFileHeader header;
+  std::vector<uint64_t> offsets;
+};
+
+/// Read only memory map of an event file
+class EICEventFile
+{
+ public:
+  explicit EICEventFile(const std::string &path)
+  {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+      return;
+    }
+    struct stat status;
+    if (fstat(fd, &status) == 0 && static_cast<std::size_t>(status.st_size) >= sizeof(EICEventFileHeader))
+    {
+      size = status.st_size;
+      void *mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+      data = mapped == MAP_FAILED ? nullptr : static_cast<const char *>(mapped);
+    }
+    close(fd);
+    if (data && !Valid())
+    {
+      Unmap();
+    }
+  }
+
+  ~EICEventFile() { Unmap(); }
+
+  EICEventFile(const EICEventFile &) = delete;
+  EICEventFile &operator=(const EICEventFile &) = delete;
+
+  bool IsOpen() const { return data != nullptr; }
+
+  uint64_t NEvents() const { return Header().nEvents; }
+
+  /// Header of an event, nullptr if it is out of range or its offset or
+  /// particles lie outside the events of a damaged file
+  const EICEventHeader *Event(uint64_t event) const
+  {
+    if (event >= NEvents())
+    {
+      return nullptr;
+    }
+    uint64_t offset = Index()[event];
+    uint64_t end = Header().indexOffset;
+    if (offset < sizeof(EICEventFileHeader) || offset > end || end - offset < sizeof(EICEventHeader))
+    {
+      return nullptr;
+    }
+    const EICEventHeader *header = reinterpret_cast<const EICEventHeader *>(data + offset);
+    if ((end - offset - sizeof(EICEventHeader)) / sizeof(EICParticle) < header->nParticles)
+    {
+      return nullptr;
+    }
+    return header;
+  }
+
+  /// Particles of an event Event accepted
+  const EICParticle *Particles(const EICEventHeader *event) const
+  {
+    return reinterpret_cast<const EICParticle *>(event + 1);
+  }
+
+ private:
+  const EICEventFileHeader &Header() const { return *reinterpret_cast<const EICEventFileHeader *>(data); }
+  const uint64_t *Index() const { return reinterpret_cast<const uint64_t *>(data + Header().indexOffset); }
+
+  bool Valid() const
+  {
+    const EICEventFileHeader &header = Header();
+    return std::memcmp(header.magic, kEICEventMagic, sizeof(kEICEventMagic)) == 0 && header.indexOffset >= sizeof(header) &&
+           header.indexOffset % sizeof(uint64_t) == 0 && header.indexOffset <= size &&
+           header.nEvents <= (size - header.indexOffset) / sizeof(uint64_t);
+  }
+
+  void Unmap()
+  {
+    if (data)
+    {
+      munmap(const_cast<char *>(data), size);
+      data = nullptr;
+    }
+  }
+
+  const char *data = nullptr;
+  std::size_t size = 0;
+};
+
+#endif  // EICEVENTFILE_H
@@ -0,0 +1,221 @@
+#include "FastCalorimeter.h"
+
+#include "FastShowerParametrization.h"
+
+#include <calobase/RawTower.h>
+#include <calobase/RawTowerContainer.h>
+#include <calobase/RawTowerDefs.h>
+#include <calobase/RawTowerGeomContainerv1.h>
+#include <calobase/RawTowerGeomv3.h>
+#include <calobase/RawTowerv1.h>
+
+#include <fun4all/Fun4AllReturnCodes.h>
+
+#include <g4main/PHG4Hit.h>
+#include <g4main/PHG4HitContainer.h>
+#include <g4main/PHG4Particle.h>
+#include <g4main/PHG4TruthInfoContainer.h>
+
+#include <phool/PHCompositeNode.h>
+#include <phool/PHIODataNode.h>
+#include <phool/PHNodeIterator.h>
+#include <phool/PHRandomSeed.h>
+#include <phool/getClass.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+//____________________________________________________________________________..
+FastCalorimeter::FastCalorimeter(const std::string &detectorName, const std::string &name):
+ SubsysReco(name + "_" + detectorName)
+ , detector(detectorName)
+ , towerSuffix(detectorName)
+{
+  random.seed(PHRandomSeed());
+}
+
+//____________________________________________________________________________..
+void FastCalorimeter::set_cylinder_towers(double radius, double minEta, double maxEta, int etaBins, int phiBins)
+{
+  cylinder = true;
+  towerRadius = radius;
+  etaMin = minEta;
+  etaMax = maxEta;
+  nEta = etaBins;
+  nPhi = phiBins;
+}
+
+//____________________________________________________________________________..
+void FastCalorimeter::set_plane_towers(double z, double extent, double size)
+{
+  cylinder = false;
+  planeZ = z;
+  halfWidth = extent;
+  towerSize = size;
+  nX = int(std::ceil(2 * halfWidth / towerSize));
+}
+
+//____________________________________________________________________________..
+void FastCalorimeter::set_depth(double x0First, double x0Last, double lambdaFirst, double lambdaLast)
+{
+  x0Start = x0First;
+  x0End = x0Last;
+  lambdaStart = lambdaFirst;
+  lambdaEnd = lambdaLast;
+}
+
+//____________________________________________________________________________..
+int FastCalorimeter::InitRun(PHCompositeNode *topNode)
+{
+  const std::string towerNode = "TOWER_CALIB_" + towerSuffix;
+  towers = findNode::getClass<RawTowerContainer>(topNode, towerNode);
+  if (towers) {
+    return Fun4AllReturnCodes::EVENT_OK;
+  }
+  PHNodeIterator iter(topNode);
+  PHCompositeNode *dstNode = dynamic_cast<PHCompositeNode *>(iter.findFirst("PHCompositeNode", "DST"));
+  PHCompositeNode *runNode = dynamic_cast<PHCompositeNode *>(iter.findFirst("PHCompositeNode", "RUN"));
+  if (!dstNode || !runNode) {
+    std::cout << PHWHERE << " no DST or RUN node" << std::endl;
+    return Fun4AllReturnCodes::ABORTRUN;
+  }
+
+  // Tower geometry with the tower centers, which is all the jet input reads
+  RawTowerDefs::CalorimeterId calorimeterId = RawTowerDefs::convert_name_to_caloid(detector);
+  RawTowerGeomContainer *geometry = new RawTowerGeomContainerv1(calorimeterId);
+  int nFirst = cylinder ? nEta : nX;
+  int nSecond = cylinder ? nPhi : nX;
+  for (int i = 0; i < nFirst; i++) {
+    for (int j = 0; j < nSecond; j++) {
+      RawTowerGeomv3 *towerGeometry = new RawTowerGeomv3(RawTowerDefs::encode_towerid(calorimeterId, i, j));
+      if (cylinder) {
+        double eta = etaMin + (i + 0.5) * (etaMax - etaMin) / nEta;
+        double phi = -M_PI + (j + 0.5) * 2 * M_PI / nPhi;
+        towerGeometry->set_center_x(towerRadius * std::cos(phi));
+        towerGeometry->set_center_y(towerRadius * std::sin(phi));
+        towerGeometry->set_center_z(towerRadius * std::sinh(eta));
+      } else {
+        towerGeometry->set_center_x(-halfWidth + (i + 0.5) * towerSize);
+        towerGeometry->set_center_y(-halfWidth + (j + 0.5) * towerSize);
+        towerGeometry->set_center_z(planeZ);
+      }
+      geometry->add_tower_geometry(towerGeometry);
+    }
+  }
+  runNode->addNode(new PHIODataNode<PHObject>(geometry, "TOWERGEOM_" + towerSuffix, "PHObject"));
+
+  PHNodeIterator dstIter(dstNode);
+  PHCompositeNode *detectorNode = dynamic_cast<PHCompositeNode *>(dstIter.findFirst("PHCompositeNode", detector));
+  if (!detectorNode) {
+    detectorNode = new PHCompositeNode(detector);
+    dstNode->addNode(detectorNode);
+  }
+  towers = new RawTowerContainer(calorimeterId);
+  detectorNode->addNode(new PHIODataNode<PHObject>(towers, towerNode, "PHObject"));
+  return Fun4AllReturnCodes::EVENT_OK;
+}
+
+//____________________________________________________________________________..
+int FastCalorimeter::process_event(PHCompositeNode *topNode)
+{
+  PHG4HitContainer *hits = findNode::getClass<PHG4HitContainer>(topNode, entryHits);
+  PHG4TruthInfoContainer *truth = findNode::getClass<PHG4TruthInfoContainer>(topNode, "G4TruthInfo");
+  if (!hits || !truth) {
+    std::cout << PHWHERE << " no " << entryHits << " or G4TruthInfo" << std::endl;
+    return Fun4AllReturnCodes::ABORTRUN;
+  }
+
+  usedTracks.clear();
+  PHG4HitContainer::ConstRange range = hits->getHits();
+  for (PHG4HitContainer::ConstIterator iter = range.first; iter != range.second; ++iter) {
+    const PHG4Hit *hit = iter->second;
+    double position[3] = {hit->get_x(0), hit->get_y(0), hit->get_z(0)};
+    double momentum[3] = {hit->get_px(0), hit->get_py(0), hit->get_pz(0)};
+    double p = std::sqrt(momentum[0] * momentum[0] + momentum[1] * momentum[1] + momentum[2] * momentum[2]);
+    if (p <= 0) {
+      continue;
+    }
+    // Only particles going into the calorimeter, once
+    double outward = cylinder ? position[0] * momentum[0] + position[1] * momentum[1] : position[2] * momentum[2];
+    if (outward <= 0 || !usedTracks.insert(hit->get_trkid()).second) {
+      continue;
+    }
+    const PHG4Particle *particle = truth->GetParticle(hit->get_trkid());
+    if (!particle) {
+      continue;
+    }
+    int pid = particle->get_pid();
+    double vertexP2 = particle->get_px() * particle->get_px() + particle->get_py() * particle->get_py() + particle->get_pz() * particle->get_pz();
+    double mass = std::sqrt(std::max(0., particle->get_e() * particle->get_e() - vertexP2));
+    double energy = FastShower::AvailableEnergy(pid, std::sqrt(p * p + mass * mass), mass);
+    double direction[3] = {momentum[0] / p, momentum[1] / p, momentum[2] / p};
+
+    switch (FastShower::Classify(pid)) {
+    case FastShower::kEM: {
+      FastShower::Profile profile = FastShower::EMProfile(energy, criticalEnergy, std::abs(pid) == 22);
+      double deposit = FastShower::Smear(energy * profile.Fraction(x0Start, x0End), resolutionStochastic, resolutionConstant, random);
+      Deposit(position, direction, deposit, emRadius);
+      break;
+    }
+    case FastShower::kHadron: {
+      FastShower::Profile profile = FastShower::HadronProfile(energy);
+      double deposit = FastShower::Smear(hadronResponse * energy * profile.Fraction(lambdaStart, lambdaEnd), resolutionStochastic, resolutionConstant, random);
+      Deposit(position, direction, deposit, hadronRadius);
+      break;
+    }
+    case FastShower::kMuon:
+      Deposit(position, direction, std::min(mipEnergy, energy), 0);
+      break;
+    default:
+      break;
+    }
+  }
+  return Fun4AllReturnCodes::EVENT_OK;
+}
+
+//____________________________________________________________________________..
+void FastCalorimeter::Deposit(const double *position, const double *direction, double energy, double radius)
+{
+  if (energy <= 0) {
+    return;
+  }
+  std::vector<FastShower::Spot> spots;
+  if (radius > 0) {
+    FastShower::Spread(energy, position, direction, radius, FastShower::SpotCount(energy), random, spots);
+  } else {
+    spots.push_back(FastShower::Spot{position[0], position[1], position[2], energy});
+  }
+
+  for (const FastShower::Spot &spot : spots) {
+    int i, j;
+    if (cylinder) {
+      double eta = std::asinh(spot.z / std::sqrt(spot.x * spot.x + spot.y * spot.y));
+      double phi = std::atan2(spot.y, spot.x);
+      i = int(std::floor((eta - etaMin) / (etaMax - etaMin) * nEta));
+      j = int(std::floor((phi + M_PI) / (2 * M_PI) * nPhi)) % nPhi;
+      if (i < 0 || i >= nEta) {
+        continue;
+      }
+    } else {
+      // projected from the vertex onto the tower plane
+      double scale = planeZ / spot.z;
+      if (scale <= 0) {
+        continue;
+      }
+      i = int(std::floor((spot.x * scale + halfWidth) / towerSize));
+      j = int(std::floor((spot.y * scale + halfWidth) / towerSize));
+      if (i < 0 || i >= nX || j < 0 || j >= nX) {
+        continue;
+      }
+    }
+    RawTower *tower = towers->getTower(i, j);
+    if (!tower) {
+      tower = new RawTowerv1();
+      towers->AddTower(i, j, tower);
+    }
+    tower->set_energy(tower->get_energy() + spot.e);
+  }
+}
@@ -0,0 +1,102 @@
+// Tell emacs that this is a C++ source
+//  -*- C++ -*-.
+#ifndef FASTCALORIMETER_H
+#define FASTCALORIMETER_H
+
+#include <fun4all/SubsysReco.h>
+
+#include <random>
+#include <set>
+#include <string>
+
+class PHCompositeNode;
+class RawTowerContainer;
+
+/// Parametrized calorimeter towers in place of the Geant4 showers.  Reads the
+/// hits of the surface G4Setup_EICDetector.C puts in front of a calorimeter
+/// stack, each the entry point and momentum of a particle, and deposits
+/// FastShower profiles (FastShowerParametrization.h) into calibrated towers
+/// TOWER_CALIB_<suffix> with geometry TOWERGEOM_<suffix>, which the jet and
+/// cluster reconstruction read as usual.  One module per calorimeter; the
+/// depth window says where in the stack it sits.
+class FastCalorimeter : public SubsysReco
+{
+ public:
+
+  FastCalorimeter(const std::string &detectorName, const std::string &name = "FastCalorimeter");
+
+  virtual ~FastCalorimeter() {}
+
+  int InitRun(PHCompositeNode *topNode) override;
+
+  int process_event(PHCompositeNode *topNode) override;
+
+  /// Hit node of the entry surface.  A black hole surface has one hit per
+  /// particle; on a transparent one (validation) only the first outgoing
+  /// crossing of each track is used.
+  void set_entry_hits(const std::string &nodeName) { entryHits = nodeName; }
+
+  /// Towers go to TOWER_CALIB_<suffix>, the detector name by default
+  void set_tower_suffix(const std::string &suffix) { towerSuffix = suffix; }
+
+  /// Projective towers: nEta x nPhi bins on a cylinder of the given radius
+  void set_cylinder_towers(double radius, double minEta, double maxEta, int etaBins, int phiBins);
+
+  /// Towers of size x size in the plane z, covering |x|, |y| < extent
+  void set_plane_towers(double z, double extent, double size);
+
+  /// Depth window of the calorimeter in the stack, in radiation lengths for
+  /// electromagnetic and interaction lengths for hadronic showers
+  void set_depth(double x0First, double x0Last, double lambdaFirst, double lambdaLast);
+
+  /// Relative resolution stochastic / sqrt(E) + constant
+  void set_resolution(double stochastic, double constant) { resolutionStochastic = stochastic; resolutionConstant = constant; }
+
+  /// Calibrated tower energy of a hadronic relative to an electromagnetic deposit
+  void set_hadron_response(double response) { hadronResponse = response; }
+
+  /// Lateral spot profile radius, cm
+  void set_shower_radius(double em, double hadron) { emRadius = em; hadronRadius = hadron; }
+
+  void set_critical_energy(double e) { criticalEnergy = e; }
+
+  /// Calibrated energy of a muon crossing the calorimeter
+  void set_mip_energy(double e) { mipEnergy = e; }
+
+ private:
+ void Deposit(const double *position, const double *direction, double energy, double radius);
+
+ std::string detector;
+ std::string entryHits;
+ std::string towerSuffix;
+
+ bool cylinder = true;
+ double towerRadius = 100;
+ double etaMin = -1;
+ double etaMax = 1;
+ int nEta = 1;
+ int nPhi = 1;
+ double planeZ = 0;
+ double halfWidth = 100;
+ double towerSize = 10;
+ int nX = 1;
+
+ double x0Start = 0;
+ double x0End = 20;
+ double lambdaStart = 0;
+ double lambdaEnd = 1;
+ double resolutionStochastic = 0.1;
+ double resolutionConstant = 0.02;
+ double hadronResponse = 0.8;
+ double emRadius = 3;
+ double hadronRadius = 15;
+ double criticalEnergy = 0.01;
+ double mipEnergy = 0.3;
+
+ RawTowerContainer *towers = nullptr;
+ std::set<int> usedTracks;
+ std::mt19937 random;
+
+};
+
+#endif // FASTCALORIMETER_H
@@ -0,0 +1,206 @@
+// Tell emacs that this is a C++ source
+//  -*- C++ -*-.
+#ifndef FASTSHOWERPARAMETRIZATION_H
+#define FASTSHOWERPARAMETRIZATION_H
+
+// GFlash-style parametrized showers for the fast calorimeter mode
+// (FastCalorimeter).  A particle entering a calorimeter stack deposits the
+// part of a gamma distribution longitudinal profile that falls into each
+// calorimeter's depth window, smeared with the calorimeter's resolution, as
+// spots around the impact point with an exponential lateral profile.  No ROOT
+// or Fun4All, the constants are the PDG shower parametrizations.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace FastShower
+{
+  enum Kind
+  {
+    kNone,
+    kEM,
+    kHadron,
+    kMuon
+  };
+
+  /// Shower type of a particle by PDG id
+  inline Kind Classify(int pid)
+  {
+    switch (std::abs(pid))
+    {
+    case 11:
+    case 22:
+      return kEM;
+    case 13:
+      return kMuon;
+    case 12:
+    case 14:
+    case 16:
+      return kNone;
+    default:
+      return kHadron;
+    }
+  }
+
+  /// Energy a particle of total energy e and mass m can deposit: the kinetic
+  /// energy of protons and neutrons, e + m for their antiparticles
+  inline double AvailableEnergy(int pid, double e, double m)
+  {
+    if (pid == 2212 || pid == 2112)
+    {
+      return e - m;
+    }
+    if (pid == -2212 || pid == -2112)
+    {
+      return e + m;
+    }
+    return e;
+  }
+
+  /// Regularized lower incomplete gamma function P(a, x), series below a + 1
+  /// and continued fraction above
+  inline double GammaP(double a, double x)
+  {
+    if (x <= 0)
+    {
+      return 0;
+    }
+    double logPrefactor = a * std::log(x) - x - std::lgamma(a);
+    if (x < a + 1)
+    {
+      double term = 1 / a;
+      double sum = term;
+      for (int n = 1; n < 500 && term > sum * 1e-12; n++)
+      {
+        term *= x / (a + n);
+        sum += term;
+      }
+      return std::min(1., sum * std::exp(logPrefactor));
+    }
+    // Lentz's method for the upper function Q = 1 - P
+    const double tiny = 1e-300;
+    double b = x + 1 - a;
+    double c = 1 / tiny;
+    double d = 1 / b;
+    double h = d;
+    for (int n = 1; n < 500; n++)
+    {
+      double an = -n * (n - a);
+      b += 2;
+      d = an * d + b;
+      d = std::fabs(d) < tiny ? tiny : d;
+      c = b + an / c;
+      c = std::fabs(c) < tiny ? tiny : c;
+      d = 1 / d;
+      double delta = d * c;
+      h *= delta;
+      if (std::fabs(delta - 1) < 1e-12)
+      {
+        break;
+      }
+    }
+    return std::max(0., 1 - std::exp(logPrefactor) * h);
+  }
+
+  /// dE/dt ~ t^(alpha - 1) exp(-beta t), t in radiation or interaction lengths
+  struct Profile
+  {
+    double alpha;
+    double beta;
+
+    /// Fraction of the shower energy between depths t0 and t1
+    double Fraction(double t0, double t1) const
+    {
+      return GammaP(alpha, beta * t1) - GammaP(alpha, beta * t0);
+    }
+  };
+
+  /// Electromagnetic profile in radiation lengths, shower maximum at
+  /// ln(e / criticalEnergy) -0.5 (electrons) or +0.5 (photons)
+  inline Profile EMProfile(double e, double criticalEnergy, bool photon)
+  {
+    const double beta = 0.5;
+    double tMax = std::max(0., std::log(e / criticalEnergy) + (photon ? 0.5 : -0.5));
+    return Profile{beta * tMax + 1, beta};
+  }
+
+  /// Hadronic profile in interaction lengths, shower maximum at
+  /// 0.2 ln(e / GeV) + 0.7; contains 95% at about the PDG length
+  inline Profile HadronProfile(double e)
+  {
+    const double beta = 1;
+    double tMax = std::max(0., 0.2 * std::log(e) + 0.7);
+    return Profile{beta * tMax + 1, beta};
+  }
+
+  /// Energy deposit smeared with a stochastic / sqrt(E) + constant resolution
+  template <class Rng>
+  double Smear(double e, double stochastic, double constant, Rng &rng)
+  {
+    if (e <= 0)
+    {
+      return 0;
+    }
+    double sigma = std::sqrt(stochastic * stochastic * e + constant * constant * e * e);
+    std::normal_distribution<double> gauss(e, sigma);
+    return std::max(0., gauss(rng));
+  }
+
+  struct Spot
+  {
+    double x;
+    double y;
+    double z;
+    double e;
+  };
+
+  /// Splits energy into nSpots spots in the plane through position
+  /// perpendicular to direction (unit vector).  The spot density falls like
+  /// exp(-r / radius), so r follows r exp(-r / radius).
+  template <class Rng>
+  void Spread(double energy, const double *position, const double *direction, double radius, int nSpots, Rng &rng, std::vector<Spot> &spots)
+  {
+    // u, v span the plane perpendicular to direction
+    double u[3];
+    if (std::fabs(direction[2]) < 0.9)
+    {
+      u[0] = -direction[1];
+      u[1] = direction[0];
+      u[2] = 0;
+    }
+    else
+    {
+      u[0] = 0;
+      u[1] = -direction[2];
+      u[2] = direction[1];
+    }
+    double norm = std::sqrt(u[0] * u[0] + u[1] * u[1] + u[2] * u[2]);
+    for (double &component : u)
+    {
+      component /= norm;
+    }
+    double v[3] = {direction[1] * u[2] - direction[2] * u[1], direction[2] * u[0] - direction[0] * u[2], direction[0] * u[1] - direction[1] * u[0]};
+
+    std::uniform_real_distribution<double> uniform(0, 1);
+    double spotEnergy = energy / nSpots;
+    for (int i = 0; i < nSpots; i++)
+    {
+      double r = -radius * std::log((1 - uniform(rng)) * (1 - uniform(rng)));
+      double angle = 2 * M_PI * uniform(rng);
+      double du = r * std::cos(angle);
+      double dv = r * std::sin(angle);
+      spots.push_back(Spot{position[0] + du * u[0] + dv * v[0], position[1] + du * u[1] + dv * v[1], position[2] + du * u[2] + dv * v[2], spotEnergy});
+    }
+  }
+
+  /// Spots per shower: about ten per GeV, at least 10 and at most 200
+  inline int SpotCount(double e)
+  {
+    return std::max(10, std::min(200, int(10 * e)));
+  }
+}
+
+#endif // FASTSHOWERPARAMETRIZATION_H
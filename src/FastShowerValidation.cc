@@ -0,0 +1,156 @@
+#include "FastShowerValidation.h"
+
+#include "JetMatching.h"
+#include "JetResolutionCore.h"
+
+#include <calobase/RawTower.h>
+#include <calobase/RawTowerContainer.h>
+#include <calobase/RawTowerGeom.h>
+#include <calobase/RawTowerGeomContainer.h>
+
+#include <fun4all/Fun4AllReturnCodes.h>
+
+#include <g4jets/Jet.h>
+#include <g4jets/JetMap.h>
+
+#include <phool/PHCompositeNode.h>
+#include <phool/getClass.h>
+
+#include <TFile.h>
+#include <TH1D.h>
+#include <TH2D.h>
+
+#include <cmath>
+#include <iostream>
+
+namespace
+{
+  const char *variantName[2] = {"full", "fast"};
+
+  std::string TowerNode(const std::string &detector, int variant)
+  {
+    return std::string(variant ? "TOWER_CALIB_FAST_" : "TOWER_CALIB_") + detector;
+  }
+
+  std::string GeometryNode(const std::string &detector, int variant)
+  {
+    return std::string(variant ? "TOWERGEOM_FAST_" : "TOWERGEOM_") + detector;
+  }
+}
+
+//____________________________________________________________________________..
+FastShowerValidation::FastShowerValidation(const std::string &filename, const std::string &name):
+ SubsysReco(name)
+ , outputFile(filename)
+{
+}
+
+//____________________________________________________________________________..
+int FastShowerValidation::Init(PHCompositeNode *topNode)
+{
+  for (const std::string &detector : detectors) {
+    CalorimeterHistograms histograms;
+    for (int variant = 0; variant < 2; variant++) {
+      std::string suffix = detector + "_" + variantName[variant];
+      histograms.towerEnergy[variant] = new TH1D(("towerEnergy_" + suffix).c_str(), (detector + " towers;E_{tower} [GeV];towers").c_str(), 200, 0, 20);
+      histograms.totalEnergy[variant] = new TH1D(("totalEnergy_" + suffix).c_str(), (detector + " energy sum;#sum E_{tower} [GeV];events").c_str(), 200, 0, 100);
+      histograms.towerEnergy[variant]->SetDirectory(nullptr);
+      histograms.totalEnergy[variant]->SetDirectory(nullptr);
+    }
+    calorimeterHistograms.push_back(histograms);
+  }
+  for (int variant = 0; variant < 2; variant++) {
+    jetResponse[variant] = new TH2D((std::string("jetResponse_") + variantName[variant]).c_str(),
+                                    "Tower energy in the truth jet radius;E_{truth} [GeV];#sum E_{tower} / E_{truth}",
+                                    JetTruthEnergyAxis::bins, JetTruthEnergyAxis::min(), JetTruthEnergyAxis::max(), 150, 0, 1.5);
+    jetResponse[variant]->SetDirectory(nullptr);
+  }
+  return Fun4AllReturnCodes::EVENT_OK;
+}
+
+//____________________________________________________________________________..
+int FastShowerValidation::process_event(PHCompositeNode *topNode)
+{
+  for (int variant = 0; variant < 2; variant++) {
+    towerPositions[variant].clear();
+    for (size_t i = 0; i < detectors.size(); i++) {
+      RawTowerContainer *towers = findNode::getClass<RawTowerContainer>(topNode, TowerNode(detectors[i], variant));
+      RawTowerGeomContainer *geometry = findNode::getClass<RawTowerGeomContainer>(topNode, GeometryNode(detectors[i], variant));
+      if (!towers || !geometry) {
+        std::cout << PHWHERE << " no " << TowerNode(detectors[i], variant) << " or its geometry" << std::endl;
+        return Fun4AllReturnCodes::ABORTRUN;
+      }
+      double total = 0;
+      RawTowerContainer::ConstRange range = towers->getTowers();
+      for (RawTowerContainer::ConstIterator iter = range.first; iter != range.second; ++iter) {
+        const RawTower *tower = iter->second;
+        const RawTowerGeom *towerGeometry = geometry->get_tower_geometry(tower->get_key());
+        if (!towerGeometry || tower->get_energy() <= 0) {
+          continue;
+        }
+        calorimeterHistograms[i].towerEnergy[variant]->Fill(tower->get_energy());
+        total += tower->get_energy();
+        double x = towerGeometry->get_center_x();
+        double y = towerGeometry->get_center_y();
+        float eta = std::asinh(towerGeometry->get_center_z() / std::sqrt(x * x + y * y));
+        towerPositions[variant].push_back(TowerPosition{eta, float(std::atan2(y, x)), float(tower->get_energy())});
+      }
+      calorimeterHistograms[i].totalEnergy[variant]->Fill(total);
+    }
+  }
+
+  JetMap *jets = findNode::getClass<JetMap>(topNode, truthJets);
+  if (!jets) {
+    return Fun4AllReturnCodes::EVENT_OK;
+  }
+  const float maxDR2 = jetRadius * jetRadius;
+  for (JetMap::Iter iter = jets->begin(); iter != jets->end(); ++iter) {
+    const Jet *jet = iter->second;
+    for (int variant = 0; variant < 2; variant++) {
+      double sum = 0;
+      for (const TowerPosition &tower : towerPositions[variant]) {
+        if (JetMatching::DeltaR2(jet->get_eta(), jet->get_phi(), tower.eta, tower.phi) < maxDR2) {
+          sum += tower.e;
+        }
+      }
+      jetResponse[variant]->Fill(jet->get_e(), sum / jet->get_e());
+    }
+  }
+  return Fun4AllReturnCodes::EVENT_OK;
+}
+
+//____________________________________________________________________________..
+int FastShowerValidation::End(PHCompositeNode *topNode)
+{
+  std::cout << "FastShowerValidation: full simulation vs parametrized showers" << std::endl;
+  for (size_t i = 0; i < detectors.size(); i++) {
+    const CalorimeterHistograms &histograms = calorimeterHistograms[i];
+    std::cout << "  " << detectors[i] << ": energy sum " << histograms.totalEnergy[0]->GetMean() << " vs " << histograms.totalEnergy[1]->GetMean()
+              << " GeV, tower spectrum KS probability " << histograms.towerEnergy[0]->KolmogorovTest(histograms.towerEnergy[1]) << std::endl;
+  }
+  TH1D *response[2];
+  for (int variant = 0; variant < 2; variant++) {
+    response[variant] = jetResponse[variant]->ProjectionY((std::string("jetResponseAll_") + variantName[variant]).c_str());
+    response[variant]->SetDirectory(nullptr);
+  }
+  std::cout << "  jet response " << response[0]->GetMean() << " +- " << response[0]->GetRMS() << " vs " << response[1]->GetMean() << " +- "
+            << response[1]->GetRMS() << ", KS probability " << response[0]->KolmogorovTest(response[1]) << std::endl;
+
+  TFile file(outputFile.c_str(), "RECREATE");
+  if (file.IsZombie()) {
+    std::cout << "Could not write fast shower validation to " << outputFile << std::endl;
+    return Fun4AllReturnCodes::EVENT_OK;
+  }
+  for (const CalorimeterHistograms &histograms : calorimeterHistograms) {
+    for (int variant = 0; variant < 2; variant++) {
+      histograms.towerEnergy[variant]->Write();
+      histograms.totalEnergy[variant]->Write();
+    }
+  }
+  for (int variant = 0; variant < 2; variant++) {
+    jetResponse[variant]->Write();
+    response[variant]->Write();
+  }
+  file.Close();
+  return Fun4AllReturnCodes::EVENT_OK;
+}
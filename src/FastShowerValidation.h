@@ -0,0 +1,64 @@
+// Tell emacs that this is a C++ source
+//  -*- C++ -*-.
+#ifndef FASTSHOWERVALIDATION_H
+#define FASTSHOWERVALIDATION_H
+
+#include <fun4all/SubsysReco.h>
+
+#include <string>
+#include <vector>
+
+class PHCompositeNode;
+class TH1D;
+class TH2D;
+
+/// Compares the parametrized towers of FastCalorimeter (TOWER_CALIB_FAST_<det>)
+/// with the full simulation towers (TOWER_CALIB_<det>) of the same events:
+/// tower energy spectra and energy sums per calorimeter, and the response of
+/// the towers within the jet radius of every truth jet.  End writes the
+/// histograms and prints means and Kolmogorov probabilities.
+class FastShowerValidation : public SubsysReco
+{
+ public:
+
+  FastShowerValidation(const std::string &filename = "fastshower_validation.root", const std::string &name = "FastShowerValidation");
+
+  virtual ~FastShowerValidation() {}
+
+  int Init(PHCompositeNode *topNode) override;
+
+  int process_event(PHCompositeNode *topNode) override;
+
+  int End(PHCompositeNode *topNode) override;
+
+  void add_calorimeter(const std::string &detector) { detectors.push_back(detector); }
+
+  void set_truth_jets(const std::string &nodeName, double radius) { truthJets = nodeName; jetRadius = radius; }
+
+ private:
+ // index 0 full simulation, 1 parametrized
+ struct CalorimeterHistograms
+ {
+   TH1D *towerEnergy[2];
+   TH1D *totalEnergy[2];
+ };
+
+ struct TowerPosition
+ {
+   float eta;
+   float phi;
+   float e;
+ };
+
+ std::string outputFile;
+ std::vector<std::string> detectors;
+ std::string truthJets = "AntiKt_Truth_r04";
+ double jetRadius = 0.4;
+
+ std::vector<CalorimeterHistograms> calorimeterHistograms;
+ TH2D *jetResponse[2] = {nullptr, nullptr};
+ std::vector<TowerPosition> towerPositions[2];
+
+};
+
+#endif // FASTSHOWERVALIDATION_H
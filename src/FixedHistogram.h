@@ -0,0 +1,172 @@
+// Tell emacs that this is a C++ source
+//  -*- C++ -*-.
+#ifndef FIXEDHISTOGRAM_H
+#define FIXEDHISTOGRAM_H
+
+// Histograms with compile time uniform axes for the fill hot loops.
+//
+// Bin lookup is a constexpr multiply and truncate, there are no statistics or
+// gDirectory bookkeeping per fill, and bins use ROOT's global bin numbering
+// (0 = underflow, bins + 1 = overflow, x + (nx + 2) * y) so the contents copy
+// straight into a TH1D/TH2D once filling is done.
+//
+// FixedHist is plain storage meant to be owned by one thread and merged with
+// Add().
+
+#include <TH1D.h>
+#include <TH2D.h>
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+
+// NBINS uniform bins from LO / SCALE to HI / SCALE.  Any type providing bins,
+// min() and max() the same way can be used as an axis.
+template <int NBINS, int LO, int HI, int SCALE = 1>
+struct UniformAxis
+{
+  static constexpr int bins = NBINS;
+  static constexpr double min() { return double(LO) / SCALE; }
+  static constexpr double max() { return double(HI) / SCALE; }
+};
+
+template <class Axis>
+constexpr int FixedBin(double x)
+{
+  if (x < Axis::min())
+  {
+    return 0;
+  }
+  if (!(x < Axis::max()))  // NaN fails every comparison and goes to the overflow as well
+  {
+    return Axis::bins + 1;
+  }
+  int bin = 1 + static_cast<int>((x - Axis::min()) * (Axis::bins / (Axis::max() - Axis::min())));
+  return bin > Axis::bins ? Axis::bins : bin;  // rounding just below max
+}
+
+template <class XAxis>
+struct Binning1D
+{
+  static constexpr int cells = XAxis::bins + 2;
+  static constexpr int Cell(double x) { return FixedBin<XAxis>(x); }
+  static TH1 *Book(const char *name, const char *title)
+  {
+    return new TH1D(name, title, XAxis::bins, XAxis::min(), XAxis::max());
+  }
+};
+
+template <class XAxis, class YAxis>
+struct Binning2D
+{
+  static constexpr int cells = (XAxis::bins + 2) * (YAxis::bins + 2);
+  static constexpr int Cell(double x, double y) { return FixedBin<XAxis>(x) + (XAxis::bins + 2) * FixedBin<YAxis>(y); }
+  static TH1 *Book(const char *name, const char *title)
+  {
+    return new TH2D(name, title, XAxis::bins, XAxis::min(), XAxis::max(), YAxis::bins, YAxis::min(), YAxis::max());
+  }
+};
+
+template <class Binning>
+class FixedHist
+{
+ public:
+  FixedHist() { Reset(); }
+
+  template <class... Coordinates>
+  void Fill(Coordinates... x)
+  {
+    int cell = Binning::Cell(x...);
+    sumw[cell] += 1;
+    sumw2[cell] += 1;
+    entries++;
+  }
+
+  template <class... Coordinates>
+  void FillWeighted(double w, Coordinates... x)
+  {
+    int cell = Binning::Cell(x...);
+    sumw[cell] += w;
+    sumw2[cell] += w * w;
+    entries++;
+  }
+
+  void Add(const FixedHist &other)
+  {
+    for (int i = 0; i < Binning::cells; i++)
+    {
+      sumw[i] += other.sumw[i];
+      sumw2[i] += other.sumw2[i];
+    }
+    entries += other.entries;
+  }
+
+  void Reset()
+  {
+    sumw.fill(0);
+    sumw2.fill(0);
+    entries = 0;
+  }
+
+  double GetCellContent(int cell) const { return sumw[cell]; }
+  double GetCellSumw2(int cell) const { return sumw2[cell]; }
+  double GetEntries() const { return entries; }
+
+  /// Add to one cell, e.g. from a delta sent by another process; entries separately
+  void AddCell(int cell, double w, double w2)
+  {
+    sumw[cell] += w;
+    sumw2[cell] += w2;
+  }
+  void AddEntries(double n) { entries += n; }
+
+  /// Add the contents to an existing histogram with the same binning.
+  /// SetBinContent counts an entry per call, so the entries are restored after.
+  void AddTo(TH1 *hist) const
+  {
+    double histEntries = hist->GetEntries();
+    if (hist->GetSumw2N() == 0)
+    {
+      hist->Sumw2();  // otherwise the errors are sqrt(content)
+    }
+    for (int i = 0; i < Binning::cells; i++)
+    {
+      if (sumw[i] == 0)
+      {
+        continue;
+      }
+      double error = hist->GetBinError(i);
+      hist->SetBinContent(i, hist->GetBinContent(i) + sumw[i]);
+      hist->SetBinError(i, std::sqrt(error * error + sumw2[i]));
+    }
+    hist->SetEntries(histEntries + entries);
+  }
+
+  /// Add the contents of a histogram with the same binning, e.g. one written by MakeHist
+  void AddFrom(const TH1 *hist)
+  {
+    for (int i = 0; i < Binning::cells; i++)
+    {
+      double error = hist->GetBinError(i);
+      sumw[i] += hist->GetBinContent(i);
+      sumw2[i] += error * error;
+    }
+    entries += hist->GetEntries();
+  }
+
+  /// New TH1D/TH2D with these contents, owned by the caller
+  TH1 *MakeHist(const char *name, const char *title = "") const
+  {
+    TH1 *hist = Binning::Book(name, title);
+    hist->Sumw2();
+    AddTo(hist);
+    return hist;
+  }
+
+ private:
+  std::array<double, Binning::cells> sumw;
+  std::array<double, Binning::cells> sumw2;
+  double entries = 0;
+};
+
+#endif  // FIXEDHISTOGRAM_H
@@ -0,0 +1,185 @@
+// Tell emacs that this is a C++ source
+//  -*- C++ -*-.
+#ifndef JETAGGREGATOR_H
+#define JETAGGREGATOR_H
+
+// Live aggregation of the response histogram of concurrent local jobs.
+// Every job pushes the cells that changed since its last push to the
+// jetAggregator daemon (jetAggregator.cc) over a Unix stream socket; the
+// daemon keeps the merged histogram and writes a single output file, so no
+// merge is needed once the jobs are done.
+//
+// Messages, native byte order (both ends run on the same node):
+//   header   uint32 magic "JAGG", uint32 type, uint32 nCells, uint32 pid,
+//            uint64 job, uint64 firstEvent, uint64 events, double entries
+//   cells    nCells x {uint32 cell, uint32 unused, double sumw, double sumw2}
+// A delta carries the events [firstEvent, firstEvent + events) of the job it
+// covers; done ends the job.  job identifies a job across restarts (see
+// JobId), so the daemon can tell a resumed job from a new one and drop events
+// it already has.
+
+#include "FixedHistogram.h"
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace JetAggregator
+{
+  const uint32_t kMagic = 0x4747414a;  // "JAGG"
+  const uint32_t kDelta = 1;
+  const uint32_t kDone = 2;
+
+  struct MessageHeader
+  {
+    uint32_t magic;
+    uint32_t type;
+    uint32_t nCells;
+    uint32_t pid;
+    uint64_t job;
+    uint64_t firstEvent;
+    uint64_t events;
+    double entries;
+  };
+
+  struct Cell
+  {
+    uint32_t cell;
+    uint32_t unused;
+    double sumw;
+    double sumw2;
+  };
+
+  inline bool WriteAll(int fd, const void *data, std::size_t size)
+  {
+    const char *bytes = static_cast<const char *>(data);
+    while (size > 0)
+    {
+      ssize_t written = send(fd, bytes, size, MSG_NOSIGNAL);
+      if (written <= 0)
+      {
+        return false;
+      }
+      bytes += written;
+      size -= written;
+    }
+    return true;
+  }
+
+  /// Job id of a job name that stays the same when the job is resumed (FNV-1a)
+  inline uint64_t JobId(const std::string &name)
+  {
+    uint64_t hash = 14695981039346656037ULL;
+    for (unsigned char c : name)
+    {
+      hash = (hash ^ c) * 1099511628211ULL;
+    }
+    return hash;
+  }
+
+  /// Fills address for the socket path, false if the path is too long
+  inline bool SocketAddress(const std::string &path, sockaddr_un &address)
+  {
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path))
+    {
+      return false;
+    }
+    std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+    return true;
+  }
+}  // namespace JetAggregator
+
+/// Job side: pushes histogram deltas to a running jetAggregator
+class JetAggregatorClient
+{
+ public:
+  JetAggregatorClient(const std::string &socketPath, uint64_t jobId)
+    : job(jobId)
+  {
+    sockaddr_un address;
+    if (!JetAggregator::SocketAddress(socketPath, address))
+    {
+      return;
+    }
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd >= 0 && connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0)
+    {
+      close(fd);
+      fd = -1;
+    }
+  }
+
+  ~JetAggregatorClient()
+  {
+    if (fd >= 0)
+    {
+      close(fd);
+    }
+  }
+
+  JetAggregatorClient(const JetAggregatorClient &) = delete;
+  JetAggregatorClient &operator=(const JetAggregatorClient &) = delete;
+
+  bool IsOpen() const { return fd >= 0; }
+
+  /// Send the non-empty cells of delta, covering events [firstEvent,
+  /// firstEvent + events) of the job, and reset it once sent
+  template <class Binning>
+  bool Push(FixedHist<Binning> &delta, uint64_t firstEvent, uint64_t events)
+  {
+    cells.clear();
+    for (int i = 0; i < Binning::cells; i++)
+    {
+      if (delta.GetCellContent(i) != 0 || delta.GetCellSumw2(i) != 0)
+      {
+        cells.push_back({static_cast<uint32_t>(i), 0, delta.GetCellContent(i), delta.GetCellSumw2(i)});
+      }
+    }
+    JetAggregator::MessageHeader header = {JetAggregator::kMagic, JetAggregator::kDelta, static_cast<uint32_t>(cells.size()),
+                                           static_cast<uint32_t>(getpid()), job, firstEvent, events, delta.GetEntries()};
+    if (!Send(header))
+    {
+      return false;
+    }
+    delta.Reset();
+    return true;
+  }
+
+  /// Tell the aggregator this job is finished
+  bool Done()
+  {
+    cells.clear();
+    JetAggregator::MessageHeader header = {JetAggregator::kMagic, JetAggregator::kDone, 0, static_cast<uint32_t>(getpid()), job, 0, 0, 0};
+    return Send(header);
+  }
+
+ private:
+  bool Send(const JetAggregator::MessageHeader &header)
+  {
+    if (fd < 0)
+    {
+      return false;
+    }
+    bool sent = JetAggregator::WriteAll(fd, &header, sizeof(header)) &&
+                JetAggregator::WriteAll(fd, cells.data(), cells.size() * sizeof(JetAggregator::Cell));
+    if (!sent)
+    {
+      close(fd);
+      fd = -1;
+    }
+    return sent;
+  }
+
+  int fd = -1;
+  uint64_t job;
+  std::vector<JetAggregator::Cell> cells;
+};
+
+#endif  // JETAGGREGATOR_H
@@ -0,0 +1,337 @@
+// Tell emacs that this is a C++ source
+//  -*- C++ -*-.
+#ifndef JETCOLUMNCACHE_H
+#define JETCOLUMNCACHE_H
+
+// Columnar float32 cache of a flat jet tree (ntp_truthjet, RecoJetTree) for
+// repeat analyses.  The file is memory mapped and read in place: no
+// decompression, no TTree, every column of a block is one aligned float array.
+//
+// Layout, native byte order, everything 64 byte aligned:
+//   header      magic "JETCOL01", nColumns, blockRows, nBlocks, nRows,
+//               indexOffset, source path of the converted file
+//   names       nColumns x char[32]
+//   blocks      per block, per column: rows floats
+//   index       per block: uint64 offset, uint64 rows, then per column
+//               float min, max (NaN entries excluded)
+//
+// Rows are written in tree entry order, so entry numbers stay meaningful.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace JetColumnCache
+{
+  const char kMagic[8] = {'J', 'E', 'T', 'C', 'O', 'L', '0', '1'};
+  const std::size_t kAlign = 64;
+  const std::size_t kNameSize = 32;
+  const uint32_t kDefaultBlockRows = 1 << 16;
+
+  struct Header
+  {
+    char magic[8];
+    uint32_t nColumns;
+    uint32_t blockRows;
+    uint64_t nBlocks;
+    uint64_t nRows;
+    uint64_t indexOffset;
+    char source[512];
+  };
+
+  struct ColumnRange
+  {
+    float min;
+    float max;
+  };
+
+  inline uint64_t Aligned(uint64_t offset) { return (offset + kAlign - 1) / kAlign * kAlign; }
+
+  /// True if path starts with the cache magic
+  inline bool IsCache(const std::string &path)
+  {
+    char magic[sizeof(kMagic)];
+    FILE *file = std::fopen(path.c_str(), "rb");
+    if (!file)
+    {
+      return false;
+    }
+    bool isCache = std::fread(magic, 1, sizeof(magic), file) == sizeof(magic) && std::memcmp(magic, kMagic, sizeof(magic)) == 0;
+    std::fclose(file);
+    return isCache;
+  }
+}  // namespace JetColumnCache
+
+/// Streams rows into a cache file one block at a time
+class JetColumnWriter
+{
+ public:
+  JetColumnWriter(const std::string &path, const std::vector<std::string> &columnNames, const std::string &source,
+                  uint32_t blockRows = JetColumnCache::kDefaultBlockRows)
+    : path(path)
+    , names(columnNames)
+    , block(columnNames.size(), std::vector<float>())
+  {
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, JetColumnCache::kMagic, sizeof(header.magic));
+    header.nColumns = names.size();
+    header.blockRows = blockRows;
+    std::strncpy(header.source, source.c_str(), sizeof(header.source) - 1);
+    for (std::vector<float> &column : block)
+    {
+      column.reserve(blockRows);
+    }
+    if (names.empty())
+    {
+      return;
+    }
+    file = std::fopen(path.c_str(), "wb");
+    if (!file)
+    {
+      return;
+    }
+    Write(&header, sizeof(header), 1);
+    for (const std::string &name : names)
+    {
+      char padded[JetColumnCache::kNameSize] = {0};
+      std::strncpy(padded, name.c_str(), sizeof(padded) - 1);
+      Write(padded, sizeof(padded), 1);
+    }
+    Pad();
+  }
+
+  ~JetColumnWriter() { Close(); }
+
+  bool IsOpen() const { return file != nullptr; }
+
+  /// One value per column, in the order of the column names
+  void Fill(const float *row)
+  {
+    for (std::size_t i = 0; i < block.size(); i++)
+    {
+      block[i].push_back(row[i]);
+    }
+    if (block[0].size() == header.blockRows)
+    {
+      FlushBlock();
+    }
+  }
+
+  /// Write the last block, the index and the final header.  False if any
+  /// write failed (e.g. a full disk); the incomplete file is then removed.
+  bool Close()
+  {
+    if (!file)
+    {
+      return false;
+    }
+    if (!block.empty() && !block[0].empty())
+    {
+      FlushBlock();
+    }
+    header.indexOffset = std::ftell(file);
+    for (std::size_t b = 0; b < offsets.size(); b++)
+    {
+      uint64_t entry[2] = {offsets[b], rows[b]};
+      Write(entry, sizeof(entry), 1);
+      Write(&ranges[b * names.size()], sizeof(JetColumnCache::ColumnRange), names.size());
+    }
+    good = good && std::fseek(file, 0, SEEK_SET) == 0;
+    Write(&header, sizeof(header), 1);
+    good = std::fclose(file) == 0 && good;
+    file = nullptr;
+    if (!good)
+    {
+      std::remove(path.c_str());
+    }
+    return good;
+  }
+
+ private:
+  void Write(const void *data, std::size_t size, std::size_t n)
+  {
+    if (n > 0 && std::fwrite(data, size, n, file) != n)
+    {
+      good = false;
+    }
+  }
+
+  void Pad()
+  {
+    static const char zeros[JetColumnCache::kAlign] = {0};
+    long offset = std::ftell(file);
+    Write(zeros, 1, JetColumnCache::Aligned(offset) - offset);
+  }
+
+  void FlushBlock()
+  {
+    offsets.push_back(std::ftell(file));
+    rows.push_back(block[0].size());
+    for (std::vector<float> &column : block)
+    {
+      JetColumnCache::ColumnRange range = {std::numeric_limits<float>::infinity(), -std::numeric_limits<float>::infinity()};
+      for (float value : column)
+      {
+        if (!std::isnan(value))
+        {
+          range.min = std::min(range.min, value);
+          range.max = std::max(range.max, value);
+        }
+      }
+      ranges.push_back(range);
+      Write(column.data(), sizeof(float), column.size());
+      Pad();
+      column.clear();
+    }
+    header.nRows += rows.back();
+    header.nBlocks++;
+  }
+
+  FILE *file = nullptr;
+  bool good = true;
+  std::string path;
+  JetColumnCache::Header header;
+  std::vector<std::string> names;
+  std::vector<std::vector<float>> block;
+  std::vector<uint64_t> offsets;
+  std::vector<uint64_t> rows;
+  std::vector<JetColumnCache::ColumnRange> ranges;
+};
+
+/// Read only memory map of a cache file
+class JetColumnFile
+{
+ public:
+  explicit JetColumnFile(const std::string &path)
+  {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+      return;
+    }
+    struct stat status;
+    if (fstat(fd, &status) == 0 && static_cast<std::size_t>(status.st_size) >= sizeof(JetColumnCache::Header))
+    {
+      size = status.st_size;
+      void *mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+      data = mapped == MAP_FAILED ? nullptr : static_cast<const char *>(mapped);
+    }
+    close(fd);
+    if (data && !Valid())
+    {
+      Unmap();
+    }
+  }
+
+  ~JetColumnFile() { Unmap(); }
+
+  JetColumnFile(const JetColumnFile &) = delete;
+  JetColumnFile &operator=(const JetColumnFile &) = delete;
+
+  bool IsOpen() const { return data != nullptr; }
+
+  const JetColumnCache::Header &GetHeader() const { return *reinterpret_cast<const JetColumnCache::Header *>(data); }
+  uint64_t NRows() const { return GetHeader().nRows; }
+  uint64_t NBlocks() const { return GetHeader().nBlocks; }
+  uint32_t NColumns() const { return GetHeader().nColumns; }
+  std::string Source() const { return GetHeader().source; }
+
+  std::string ColumnName(uint32_t column) const
+  {
+    const char *name = data + sizeof(JetColumnCache::Header) + column * JetColumnCache::kNameSize;
+    return std::string(name, strnlen(name, JetColumnCache::kNameSize));
+  }
+
+  /// Column number of name, -1 if there is no such column
+  int Column(const std::string &name) const
+  {
+    for (uint32_t i = 0; i < NColumns(); i++)
+    {
+      if (ColumnName(i) == name)
+      {
+        return i;
+      }
+    }
+    return -1;
+  }
+
+  uint64_t BlockRows(uint64_t block) const { return IndexEntry(block)[1]; }
+
+  /// First entry number of block
+  uint64_t BlockStart(uint64_t block) const { return block * GetHeader().blockRows; }
+
+  /// BlockRows(block) values of column, in place in the mapped file
+  const float *Data(uint64_t block, uint32_t column) const
+  {
+    uint64_t offset = IndexEntry(block)[0];
+    for (uint32_t i = 0; i < column; i++)
+    {
+      offset += JetColumnCache::Aligned(BlockRows(block) * sizeof(float));
+    }
+    return reinterpret_cast<const float *>(data + offset);
+  }
+
+  const JetColumnCache::ColumnRange &Range(uint64_t block, uint32_t column) const
+  {
+    return reinterpret_cast<const JetColumnCache::ColumnRange *>(IndexEntry(block) + 2)[column];
+  }
+
+ private:
+  const uint64_t *IndexEntry(uint64_t block) const
+  {
+    std::size_t entrySize = 2 * sizeof(uint64_t) + NColumns() * sizeof(JetColumnCache::ColumnRange);
+    return reinterpret_cast<const uint64_t *>(data + GetHeader().indexOffset + block * entrySize);
+  }
+
+  /// The names, the index and every block of the index lie in the file, so a
+  /// damaged cache is rejected here instead of read past the mapping
+  bool Valid() const
+  {
+    const JetColumnCache::Header &header = GetHeader();
+    uint64_t namesEnd = sizeof(header) + uint64_t(header.nColumns) * JetColumnCache::kNameSize;
+    uint64_t entrySize = 2 * sizeof(uint64_t) + uint64_t(header.nColumns) * sizeof(JetColumnCache::ColumnRange);
+    if (std::memcmp(header.magic, JetColumnCache::kMagic, sizeof(header.magic)) != 0 || header.nColumns == 0 ||
+        namesEnd > header.indexOffset || header.indexOffset > size || header.indexOffset % sizeof(uint64_t) != 0 ||
+        header.nBlocks > (size - header.indexOffset) / entrySize)
+    {
+      return false;
+    }
+    uint64_t rows = 0;
+    for (uint64_t block = 0; block < header.nBlocks; block++)
+    {
+      uint64_t offset = IndexEntry(block)[0];
+      uint64_t blockRows = BlockRows(block);
+      if (blockRows > header.blockRows || offset < namesEnd || offset > header.indexOffset ||
+          JetColumnCache::Aligned(blockRows * sizeof(float)) > (header.indexOffset - offset) / header.nColumns)
+      {
+        return false;
+      }
+      rows += blockRows;
+    }
+    return rows == header.nRows;
+  }
+
+  void Unmap()
+  {
+    if (data)
+    {
+      munmap(const_cast<char *>(data), size);
+      data = nullptr;
+    }
+  }
+
+  const char *data = nullptr;
+  std::size_t size = 0;
+};
+
+#endif  // JETCOLUMNCACHE_H
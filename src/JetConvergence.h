@@ -0,0 +1,223 @@
+// Tell emacs that this is a C++ source
+//  -*- C++ -*-.
+#ifndef JETCONVERGENCE_H
+#define JETCONVERGENCE_H
+
+// Running jet energy resolution per truth energy bin, for stopping a
+// simulation once the resolution is known well enough instead of guessing
+// nEvents.  The moments are updated online up to the fourth, so the
+// uncertainty of the width also holds for responses with non-Gaussian tails.
+
+#include "FixedHistogram.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <limits>
+#include <ostream>
+#include <vector>
+
+/// Online weighted mean, variance and fourth central moment (Welford,
+/// extended to weights and higher moments, Pebay 2008).  The statistics use
+/// the effective number of entries, so weighted responses are not counted as
+/// more precise than they are.
+class RunningMoments
+{
+ public:
+  void Add(double x, double weight = 1)
+  {
+    if (weight <= 0)
+    {
+      return;
+    }
+    double w1 = sumw;
+    sumw += weight;
+    sumw2 += weight * weight;
+    double delta = x - mean;
+    double deltaW = delta * weight / sumw;
+    double deltaW2 = deltaW * deltaW;
+    double term = delta * deltaW * w1;
+    mean += deltaW;
+    m4 += term * delta * delta * (w1 * w1 - w1 * weight + weight * weight) / (sumw * sumw) + 6 * deltaW2 * m2 - 4 * deltaW * m3;
+    m3 += term * delta * (w1 - weight) / sumw - 3 * deltaW * m2;
+    m2 += term;
+  }
+
+  /// sumw, sumw2, mean, m2, m3, m4, e.g. for checkpoints
+  static constexpr int kStateSize = 6;
+  void GetState(double *state) const
+  {
+    state[0] = sumw;
+    state[1] = sumw2;
+    state[2] = mean;
+    state[3] = m2;
+    state[4] = m3;
+    state[5] = m4;
+  }
+  void SetState(const double *state)
+  {
+    sumw = state[0];
+    sumw2 = state[1];
+    mean = state[2];
+    m2 = state[3];
+    m3 = state[4];
+    m4 = state[5];
+  }
+
+  /// Effective number of entries, (sum w)^2 / sum w^2
+  double Entries() const { return sumw2 > 0 ? sumw * sumw / sumw2 : 0; }
+  double Mean() const { return mean; }
+  double Sigma() const { return Entries() > 1 ? std::sqrt(Variance()) : 0; }
+
+  /// Standard error of Sigma() from the variance of the sample variance,
+  /// infinite below four effective entries
+  double SigmaError() const
+  {
+    double n = Entries();
+    if (n < 4)
+    {
+      return std::numeric_limits<double>::infinity();
+    }
+    double variance = Variance();
+    if (variance <= 0)
+    {
+      return 0;
+    }
+    double varianceError2 = (m4 / sumw - variance * variance * (n - 3) / (n - 1)) / n;
+    return std::sqrt(std::max(varianceError2, 0.)) / (2 * std::sqrt(variance));
+  }
+
+ private:
+  /// Unbiased for frequency-like weights, m2 / (n - 1) without weights
+  double Variance() const { return m2 / (sumw - sumw2 / sumw); }
+
+  double sumw = 0;
+  double sumw2 = 0;
+  double mean = 0;
+  double m2 = 0;
+  double m3 = 0;
+  double m4 = 0;
+};
+
+/// Resolution of the response in each bin of Axis whose center is inside
+/// [minX, maxX); converged once every such bin has at least minEntries
+/// (effective, for weighted fills) and a
+/// resolution uncertainty of at most precision
+template <class Axis>
+class ConvergenceMonitor
+{
+ public:
+  ConvergenceMonitor(double targetPrecision, double minX, double maxX, int targetEntries)
+    : precision(targetPrecision)
+    , minEntries(targetEntries)
+    , moments(Axis::bins + 2)
+    , target(Axis::bins + 2, false)
+    , convergedAt(Axis::bins + 2, -1)
+  {
+    for (int bin = 1; bin <= Axis::bins; bin++)
+    {
+      target[bin] = Center(bin) >= minX && Center(bin) < maxX;
+    }
+  }
+
+  void Fill(double x, double response, double weight = 1)
+  {
+    int bin = FixedBin<Axis>(x);
+    if (target[bin])
+    {
+      moments[bin].Add(response, weight);
+    }
+  }
+
+  /// Mark bins that reached the precision at this event, true once all target
+  /// bins have (false if there are none)
+  bool Update(long events)
+  {
+    bool any = false;
+    bool all = true;
+    for (int bin = 1; bin <= Axis::bins; bin++)
+    {
+      if (!target[bin])
+      {
+        continue;
+      }
+      any = true;
+      if (convergedAt[bin] < 0)
+      {
+        if (moments[bin].Entries() >= minEntries && moments[bin].SigmaError() <= precision)
+        {
+          convergedAt[bin] = events;
+        }
+        else
+        {
+          all = false;
+        }
+      }
+    }
+    return any && all;
+  }
+
+  /// Moments and convergence events of every bin, for checkpoints
+  std::vector<double> GetState() const
+  {
+    std::vector<double> state((Axis::bins + 2) * (RunningMoments::kStateSize + 1));
+    for (int bin = 0; bin < Axis::bins + 2; bin++)
+    {
+      double *binState = &state[bin * (RunningMoments::kStateSize + 1)];
+      moments[bin].GetState(binState);
+      binState[RunningMoments::kStateSize] = convergedAt[bin];
+    }
+    return state;
+  }
+
+  /// Restore a GetState() of a monitor with the same Axis; false if the size doesn't match
+  bool SetState(const std::vector<double> &state)
+  {
+    if (state.size() != std::size_t(Axis::bins + 2) * (RunningMoments::kStateSize + 1))
+    {
+      return false;
+    }
+    for (int bin = 0; bin < Axis::bins + 2; bin++)
+    {
+      const double *binState = &state[bin * (RunningMoments::kStateSize + 1)];
+      moments[bin].SetState(binState);
+      convergedAt[bin] = binState[RunningMoments::kStateSize];
+    }
+    return true;
+  }
+
+  /// Per target bin: entries, resolution with its uncertainty and the events
+  /// it took to converge
+  void Print(std::ostream &out) const
+  {
+    out << "# bin center entries sigma sigmaError convergedAtEvent" << std::endl;
+    for (int bin = 1; bin <= Axis::bins; bin++)
+    {
+      if (!target[bin])
+      {
+        continue;
+      }
+      out << bin << " " << Center(bin) << " " << moments[bin].Entries() << " " << std::setprecision(4) << moments[bin].Sigma() << " "
+          << moments[bin].SigmaError() << std::setprecision(6) << " ";
+      if (convergedAt[bin] < 0)
+      {
+        out << "-" << std::endl;
+      }
+      else
+      {
+        out << convergedAt[bin] << std::endl;
+      }
+    }
+  }
+
+ private:
+  static double Center(int bin) { return Axis::min() + (bin - 0.5) * (Axis::max() - Axis::min()) / Axis::bins; }
+
+  double precision;
+  int minEntries;
+  std::vector<RunningMoments> moments;
+  std::vector<bool> target;
+  std::vector<long> convergedAt;
+};
+
+#endif  // JETCONVERGENCE_H
@@ -71,12 +71,21 @@
 #include <TTree.h>
 #include <TFile.h>
 #include <TMath.h>
+#include <TParameter.h>
+#include <TVectorD.h>
+
+#include <climits>
+#include <cstdio>
+
+#include "JetResolutionCore.h"
 
 #include <g4jets/Jet.h>
 #include <g4jets/JetMap.h>
 
 #include <g4eval/JetEvalStack.h>
 
+#include <ffaobjects/EventHeader.h>
+
 #include <fun4all/Fun4AllHistoManager.h>
 #include <fun4all/Fun4AllReturnCodes.h>
 
@@ -93,12 +102,7 @@ JetEnergyResolution::JetEnergyResolution(const std::string &name):
 {
   std::cout << "JetEnergyResolution::JetEnergyResolution(const std::string &name) Calling ctor" << std::endl;
   outfile = new TFile();
-  recoJetTree = new TTree("RecoJetTree", "A tree containing reconstructed jets");
-  recoJetTree->Branch("recoPt", &recoPt, "recoPt/D");
-  recoJetTree->Branch("recoEnergy", &recoEnergy, "recoEnergy/D");
-  recoJetTree->Branch("truthPt", &truthPt, "truthPt/D");
-  recoJetTree->Branch("truthEnergy", &truthEnergy, "truthEnergy/D");
-  recoJetTree->Branch("dR", &dR, "dR/D");
+  recoJetTree = JetResolutionCore::BookRecoJetTree(jetRow);
 }
 
 //____________________________________________________________________________..
@@ -106,6 +110,9 @@ JetEnergyResolution::~JetEnergyResolution()
 {
   std::cout << "JetEnergyResolution::~JetEnergyResolution() Calling dtor" << std::endl;
   delete recoJetTree;
+  delete recorder;
+  delete convergence;
+  delete aggregator;
 }
 
 //____________________________________________________________________________..
@@ -127,71 +134,329 @@ int JetEnergyResolution::Init(PHCompositeNode *topNode)
 int JetEnergyResolution::process_event(PHCompositeNode *topNode)
 {
   std::cout << "JetEnergyResolution::process_event(PHCompositeNode *topNode) Processing Event" << std::endl;
+  if (!checkpointFile.empty()) {
+    bool eventsDue = checkpointEvents > 0 && eventsProcessed - checkpointedEvents >= checkpointEvents;
+    bool timeDue = checkpointMinutes > 0 && std::chrono::steady_clock::now() - lastCheckpoint >= std::chrono::duration<double, std::ratio<60>>(checkpointMinutes);
+    if (eventsDue || timeDue) {
+      WriteCheckpoint();
+    }
+  }
+  eventsProcessed++;
   // Copied from AnaTutorial->getReconstructedJets
-  JetMap *recoJets = findNode::getClass<JetMap>(topNode, "AntiKt_Tower_r04");
-  JetMap *truthJets = findNode::getClass<JetMap>(topNode, "AntiKt_Truth_r04");
-  if (!jetEvalStack) {
-    jetEvalStack = new JetEvalStack(topNode, "AntiKt_Tower_r04", "AntiKt_Truth_r04");
+  JetMap *recoJets = findNode::getClass<JetMap>(topNode, recoJetNode);
+  JetMap *truthJets = findNode::getClass<JetMap>(topNode, truthJetNode);
+  JetRecoEval *recoEval = nullptr;
+  if (evalMatching) {
+    if (!jetEvalStack) {
+      jetEvalStack = new JetEvalStack(topNode, recoJetNode, truthJetNode);
+    }
+    jetEvalStack->next_event(topNode);
+    recoEval = jetEvalStack->get_reco_eval();
   }
-  jetEvalStack->next_event(topNode);
-  JetRecoEval *recoEval = jetEvalStack->get_reco_eval();
+  EventHeader *eventHeader = findNode::getClass<EventHeader>(topNode, "EventHeader");
+  // events a preselection failed but kept stand for prescale events each
+  PreselectionResult *preselection = findNode::getClass<PreselectionResult>(topNode, kPreselectionResultNode);
+  jetRow.weight = preselection ? preselection->weight : 1;
+  jetRow.preselected = preselection ? preselection->passed : true;
   if (!recoJets) {
     std::cout << "No reconstructed jet node: " << PHWHERE << std::endl;
     return Fun4AllReturnCodes::EVENT_OK;
   }
+  // Jet kinematics of this event, with the eval match as an index into the truth jets
+  jetEvent.Clear();
+  jetEvent.id = eventHeader ? eventHeader->get_EvtSequence() : eventCount;
+  jetEvent.jetParameter = recoJets->get_par();
+  truthCandidates.clear();
+  if (truthJets) {
+    for (JetMap::Iter truthIter = truthJets->begin(); truthIter != truthJets->end(); ++truthIter) {
+      AddTruthJet(truthIter->second);
+    }
+  }
   for (JetMap::Iter recoIter = recoJets->begin(); recoIter != recoJets->end(); ++recoIter) {
     Jet *recoJet = recoIter->second;
-    recoPt = recoJet->get_pt();
-    recoEnergy = recoJet->get_e();
-
-    Jet *truthJet = recoEval->max_truth_jet_by_energy(recoJet);
-    if (truthJet->get_pt() < 5) {
-      continue;
-    }
-    if (truthJet) {
-      truthPt = truthJet->get_pt();
-      truthEnergy = truthJet->get_e();
-      dR = -100;
-    }
-    else if (truthJets) {
-      float closestJet = 9999;
-      float recoEta = recoJet->get_eta();
-      float recoPhi = recoJet->get_phi();
-
-      for (JetMap::Iter truthIter = truthJets->begin(); truthIter != truthJets->end(); ++truthIter) {
-        const Jet *truthJet = truthIter->second;
-        truthPt = truthJet->get_pt();
-        truthEnergy = truthJet->get_e();
-        float truthEta = truthJet->get_eta();
-        float truthPhi = truthJet->get_phi();
-
-        float dPhi = recoPhi - truthPhi;
-        if (dPhi > TMath::Pi()) {
-          dPhi -= TMath::TwoPi();
-        }
-        if (dPhi < -1 * TMath::Pi()) {
-          dPhi += TMath::TwoPi();
-        }
-
-        float dEta = recoEta - truthEta;
-        // Calculate distance in eta phi space
-        dR = sqrt(pow(dPhi, 2) + pow(dEta, 2));
-
-        if (dR < recoJets->get_par() && dR < closestJet) {
-          closestJet = dR;
-        }
-      }
-      dR = closestJet;
-    }
-    std::cout << "filling tree" << std::endl;
-    if (dR < 9998) {
-      recoJetTree->Fill();
+    // without the eval MatchEvent falls back to the dR match
+    Jet *truthJet = recoEval ? recoEval->max_truth_jet_by_energy(recoJet) : nullptr;
+    jetEvent.AddReco(recoJet->get_pt(), recoJet->get_e(), recoJet->get_eta(), recoJet->get_phi(), truthJet ? AddTruthJet(truthJet) : -1);
+  }
+  eventCount++;
+  if (recorder) {
+    recorder->Write(jetEvent);
+  }
+
+  // the chain of a jet only varies in the stitched collection
+  bool stitched = JetRegions::IsStitched(recoJetNode);
+  int collectionRegion = JetRegions::CollectionRegion(recoJetNode);
+  JetResolutionCore::MatchEvent(jetEvent, [this, stitched, collectionRegion](const MatchedJet &jet) {
+    jetRow.SetJet(jet);
+    jetRow.region = stitched ? JetRegions::StitchRegion(jet.recoEta) : collectionRegion;
+    recoJetTree->Fill();
+    JetResolutionCore::FillResponse(responseHist, jet, jetRow.weight);
+    JetResolutionCore::FillResponse(aggregatorDelta, jet, jetRow.weight);
+    if (convergence) {
+      convergence->Fill(jet.truthEnergy, (jet.recoEnergy - jet.truthEnergy) / jet.truthEnergy, jetRow.weight);
     }
+  });
+  if (aggregator && checkpointFile.empty() && eventsProcessed - aggregatedEvents >= aggregatorEvents) {
+    PushAggregator();
+  }
+  if (convergence && convergence->Update(eventsProcessed)) {
+    std::cout << "Resolution converged in every bin after " << eventsProcessed << " events, stopping" << std::endl;
+    return Fun4AllReturnCodes::ABORT_RUN;
   }
   std::cout << "about to return from here" << std::endl;
   return Fun4AllReturnCodes::EVENT_OK;
 }
 
+//____________________________________________________________________________..
+std::vector<std::string> JetEnergyResolution::required_nodes() const
+{
+  std::vector<std::string> nodes = {recoJetNode, truthJetNode, "EventHeader"};
+  if (evalMatching) {
+    // the eval follows the tower jets back to the Geant4 hits
+    for (const char *calorimeter : {"CEMC", "HCALIN", "HCALOUT"}) {
+      nodes.push_back(std::string("G4HIT_") + calorimeter);
+    }
+    if (recoJetNode != JetRegions::kCentralTowerJets) {
+      nodes.push_back("G4HIT_FEMC");
+      nodes.push_back("G4HIT_FHCAL");
+    }
+  }
+  return nodes;
+}
+
+//____________________________________________________________________________..
+int JetEnergyResolution::AddTruthJet(const Jet *truthJet)
+{
+  // the eval's truth jets come from the same node, so this is usually a lookup
+  for (size_t i = 0; i < truthCandidates.size(); i++) {
+    if (truthCandidates[i] == truthJet) {
+      return i;
+    }
+  }
+  truthCandidates.push_back(truthJet);
+  return jetEvent.AddTruth(truthJet->get_pt(), truthJet->get_e(), truthJet->get_eta(), truthJet->get_phi());
+}
+
+//____________________________________________________________________________..
+void JetEnergyResolution::set_record_file(const std::string &filename)
+{
+  delete recorder;
+  recorder = new JetEventWriter(filename);
+  if (!recorder->IsOpen()) {
+    std::cout << "Could not open jet event record " << filename << std::endl;
+    delete recorder;
+    recorder = nullptr;
+  }
+}
+
+//____________________________________________________________________________..
+void JetEnergyResolution::set_checkpoint(const std::string &filename, int nEvents, double minutes)
+{
+  checkpointFile = filename;
+  checkpointEvents = nEvents;
+  checkpointMinutes = minutes;
+  lastCheckpoint = std::chrono::steady_clock::now();
+}
+
+//____________________________________________________________________________..
+void JetEnergyResolution::set_convergence(double precision, double minEnergy, double maxEnergy, int minEntries)
+{
+  delete convergence;
+  convergence = new ConvergenceMonitor<JetTruthEnergyAxis>(precision, minEnergy, maxEnergy, minEntries);
+}
+
+//____________________________________________________________________________..
+void JetEnergyResolution::set_aggregator(const std::string &socketPath, int nEvents, const std::string &jobName)
+{
+  std::string job = jobName;
+  if (job.empty()) {
+    job = checkpointFile.empty() ? "pid " + std::to_string(getpid()) : checkpointFile;
+    char cwd[PATH_MAX];
+    if (!checkpointFile.empty() && checkpointFile[0] != '/' && getcwd(cwd, sizeof(cwd))) {
+      job = std::string(cwd) + "/" + job;
+    }
+  }
+  delete aggregator;
+  aggregator = new JetAggregatorClient(socketPath, JetAggregator::JobId(job));
+  aggregatorEvents = nEvents;
+  if (!aggregator->IsOpen()) {
+    std::cout << "No jet aggregator on " << socketPath << ", results only go to out.root" << std::endl;
+    delete aggregator;
+    aggregator = nullptr;
+  }
+}
+
+//____________________________________________________________________________..
+void JetEnergyResolution::PushAggregator()
+{
+  if (!aggregator->Push(aggregatorDelta, aggregatedEvents, eventsProcessed - aggregatedEvents)) {
+    std::cout << "Lost the jet aggregator, results only go to out.root" << std::endl;
+    delete aggregator;
+    aggregator = nullptr;
+    return;
+  }
+  aggregatedEvents = eventsProcessed;
+}
+
+//____________________________________________________________________________..
+void JetEnergyResolution::WriteCheckpoint()
+{
+  TDirectory::TContext context;
+  // the tree entries since the last checkpoint, under a new name so the
+  // chunks the current checkpoint lists are never touched
+  Long64_t entries = recoJetTree->GetEntries();
+  if (entries > checkpointedEntries) {
+    std::string chunkFile = CheckpointChunk(checkpointChunks);
+    TFile chunk(chunkFile.c_str(), "RECREATE");
+    if (chunk.IsZombie()) {
+      std::cout << "Could not write checkpoint " << chunkFile << std::endl;
+      return;
+    }
+    TTree *newEntries = recoJetTree->CloneTree(0); // owned by chunk
+    for (Long64_t i = checkpointedEntries; i < entries; i++) {
+      recoJetTree->GetEntry(i);
+      newEntries->Fill();
+    }
+    chunk.Write();
+    chunk.Close();
+  }
+
+  // push first, so the checkpoint holds what the aggregator has not got
+  if (aggregator) {
+    PushAggregator();
+  }
+
+  // write next to the old checkpoint and rename, so a crash while writing
+  // leaves the previous one intact
+  int chunks = checkpointChunks + (entries > checkpointedEntries ? 1 : 0);
+  std::string tmpFile = checkpointFile + ".tmp";
+  TFile checkpoint(tmpFile.c_str(), "RECREATE");
+  if (checkpoint.IsZombie()) {
+    std::cout << "Could not write checkpoint " << tmpFile << std::endl;
+    return;
+  }
+  responseHist.MakeHist("ResponseHist", ";truth energy;(reco - truth) / truth"); // owned by checkpoint
+  TParameter<int>("EventsProcessed", eventsProcessed).Write();
+  TParameter<int>("EventCount", eventCount).Write();
+  TParameter<int>("Chunks", chunks).Write();
+  TParameter<Long64_t>("Entries", entries).Write();
+  TParameter<int>("AggregatedEvents", aggregatedEvents).Write();
+  aggregatorDelta.MakeHist("AggregatorDelta", ";truth energy;(reco - truth) / truth"); // owned by checkpoint
+  if (convergence) {
+    std::vector<double> state = convergence->GetState();
+    TVectorD(state.size(), state.data()).Write("ConvergenceState");
+  }
+  checkpoint.Write();
+  checkpoint.Close();
+  if (std::rename(tmpFile.c_str(), checkpointFile.c_str()) != 0) {
+    std::cout << "Could not move checkpoint to " << checkpointFile << std::endl;
+    return;
+  }
+  checkpointChunks = chunks;
+  checkpointedEntries = entries;
+  checkpointedEvents = eventsProcessed;
+  lastCheckpoint = std::chrono::steady_clock::now();
+  std::cout << "Checkpoint of " << eventsProcessed << " events written to " << checkpointFile << std::endl;
+}
+
+//____________________________________________________________________________..
+int JetEnergyResolution::resume_from_checkpoint(const std::string &filename)
+{
+  TDirectory::TContext context;
+  TFile *checkpoint = TFile::Open(filename.c_str());
+  if (!checkpoint || checkpoint->IsZombie()) {
+    std::cout << "No checkpoint " << filename << ", starting from the first event" << std::endl;
+    delete checkpoint;
+    return 0;
+  }
+  TH1 *hist = nullptr;
+  TParameter<int> *processed = nullptr;
+  TParameter<int> *count = nullptr;
+  TParameter<int> *chunks = nullptr;
+  TParameter<Long64_t> *entries = nullptr;
+  checkpoint->GetObject("ResponseHist", hist);
+  checkpoint->GetObject("EventsProcessed", processed);
+  checkpoint->GetObject("EventCount", count);
+  checkpoint->GetObject("Chunks", chunks);
+  checkpoint->GetObject("Entries", entries);
+  if (!hist || !processed || !count || !chunks || !entries) {
+    std::cout << "Incomplete checkpoint " << filename << ", starting from the first event" << std::endl;
+    checkpoint->Close();
+    delete checkpoint;
+    return 0;
+  }
+
+  // merge the tree chunks back into one tree
+  checkpointFile = filename;
+  recoJetTree->Reset();
+  for (int i = 0; i < chunks->GetVal(); i++) {
+    TFile *chunk = TFile::Open(CheckpointChunk(i).c_str());
+    TTree *tree = nullptr;
+    if (chunk && !chunk->IsZombie()) {
+      chunk->GetObject("RecoJetTree", tree);
+    }
+    if (!tree) {
+      std::cout << "Missing checkpoint chunk " << CheckpointChunk(i) << ", starting from the first event" << std::endl;
+      delete chunk;
+      recoJetTree->Reset();
+      checkpoint->Close();
+      delete checkpoint;
+      return 0;
+    }
+    JetResolutionCore::ReadRecoJetTree(tree, jetRow);
+    for (Long64_t j = 0; j < tree->GetEntries(); j++) {
+      tree->GetEntry(j);
+      recoJetTree->Fill();
+    }
+    chunk->Close();
+    delete chunk;
+  }
+  if (recoJetTree->GetEntries() != entries->GetVal()) {
+    std::cout << "Checkpoint chunks of " << filename << " don't add up, starting from the first event" << std::endl;
+    recoJetTree->Reset();
+    checkpoint->Close();
+    delete checkpoint;
+    return 0;
+  }
+  responseHist.Reset();
+  responseHist.AddFrom(hist);
+  // what the crashed run had not pushed yet, everything for a checkpoint of a
+  // run without aggregation
+  TParameter<int> *aggregated = nullptr;
+  TH1 *delta = nullptr;
+  checkpoint->GetObject("AggregatedEvents", aggregated);
+  checkpoint->GetObject("AggregatorDelta", delta);
+  aggregatorDelta.Reset();
+  if (aggregated && delta) {
+    aggregatedEvents = aggregated->GetVal();
+    aggregatorDelta.AddFrom(delta);
+  }
+  else {
+    aggregatedEvents = 0;
+    aggregatorDelta.Add(responseHist);
+  }
+  if (convergence) {
+    TVectorD *convergenceState = nullptr;
+    checkpoint->GetObject("ConvergenceState", convergenceState);
+    std::vector<double> state;
+    if (convergenceState) {
+      state.assign(convergenceState->GetMatrixArray(), convergenceState->GetMatrixArray() + convergenceState->GetNrows());
+    }
+    if (!convergence->SetState(state)) {
+      std::cout << "No convergence state in checkpoint " << filename << ", the resolution counts restart" << std::endl;
+    }
+  }
+  eventsProcessed = processed->GetVal();
+  eventCount = count->GetVal();
+  checkpointedEvents = eventsProcessed;
+  checkpointedEntries = entries->GetVal();
+  checkpointChunks = chunks->GetVal();
+  checkpoint->Close();
+  delete checkpoint;
+  std::cout << "Resumed " << eventsProcessed << " events from checkpoint " << filename << std::endl;
+  return eventsProcessed;
+}
+
 //____________________________________________________________________________..
 // int JetEnergyResolution::ResetEvent(PHCompositeNode *topNode)
 // {
@@ -211,11 +476,33 @@ int JetEnergyResolution::End(PHCompositeNode *topNode)
 {
   std::cout << "JetEnergyResolution::End(PHCompositeNode *topNode) This is the End..." << std::endl;
   outfile->cd();
+  responseHist.MakeHist("ResponseHist", ";truth energy;(reco - truth) / truth"); // owned by outfile
   recoJetTree->Write();
+  if (aggregator) {
+    PushAggregator();
+  }
+  if (aggregator) {
+    aggregator->Done();
+    delete aggregator;
+    aggregator = nullptr;
+  }
+  if (convergence) {
+    std::cout << "Energy resolution per truth energy bin after " << eventsProcessed << " events:" << std::endl;
+    convergence->Print(std::cout);
+  }
   outfile->Write();
+  delete recorder; // closes the record file
+  recorder = nullptr;
   outfile->Close();
   std::cout << "is this actually running??" << std::endl;
   delete outfile;
+  if (!checkpointFile.empty()) {
+    // out.root is complete
+    for (int i = 0; i < checkpointChunks; i++) {
+      std::remove(CheckpointChunk(i).c_str());
+    }
+    std::remove(checkpointFile.c_str());
+  }
   return Fun4AllReturnCodes::EVENT_OK;
 }
 
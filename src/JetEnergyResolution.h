@@ -3,10 +3,18 @@
 #ifndef JETENERGYRESOLUTION_H
 #define JETENERGYRESOLUTION_H
 
+#include "JetAggregator.h"
+#include "JetConvergence.h"
+#include "JetRegions.h"
+#include "JetResolutionCore.h"
+#include "TruthJetPreselection.h"
+
 #include <fun4all/SubsysReco.h>
 #include <g4eval/JetEvalStack.h>
 
+#include <chrono>
 #include <string>
+#include <vector>
 
 #include <TROOT.h>
 #include <TFile.h>
@@ -14,6 +22,7 @@
 
 class PHCompositeNode;
 class JetEvalStack;
+class Jet;
 
 class JetEnergyResolution : public SubsysReco
 {
@@ -56,15 +65,96 @@ class JetEnergyResolution : public SubsysReco
 
 //   void Print(const std::string &what = "ALL") const override;
 
+  /// Record the jet kinematics and eval matches of every event to filename,
+  /// for replaying the matching without Fun4All (see JetEventRecord.h)
+  void set_record_file(const std::string &filename);
+
+  /// Write the response histogram and the number of processed events to
+  /// filename every nEvents events and every minutes minutes (0 disables
+  /// either), so a crashed job can be resumed.  The tree entries filled since
+  /// the previous checkpoint go to a new chunk file <filename>.<n>, so each
+  /// checkpoint only writes what is new.  All are removed again by End.
+  void set_checkpoint(const std::string &filename, int nEvents, double minutes = 0);
+
+  /// Reload the state of a checkpoint written by an earlier run of the same
+  /// job.  Returns the number of events it covers, which the macro skips in
+  /// the input, or 0 if there is no usable checkpoint.
+  int resume_from_checkpoint(const std::string &filename);
+
+  /// Stop the run (ABORT_RUN, End still writes everything) once the energy
+  /// resolution of every truth energy bin in [minEnergy, maxEnergy) has at
+  /// least minEntries jets and an uncertainty of at most precision.  Jets
+  /// count with the preselection weight, entries are effective ones.  End
+  /// prints the entries and the events used per bin.  The running moments are
+  /// part of the checkpoints; call before resume_from_checkpoint to restore them.
+  void set_convergence(double precision, double minEnergy = JetTruthEnergyAxis::min(),
+                       double maxEnergy = JetTruthEnergyAxis::max(), int minEntries = 100);
+
+  /// Push the response histogram filled since the last push to the
+  /// jetAggregator listening on socketPath every nEvents events and at End,
+  /// so concurrent jobs on a node are merged live.  out.root is still written.
+  /// With checkpoints the pushes go with the checkpoints instead, which keep
+  /// what is not pushed yet, so a resumed job sends every event once.
+  /// jobName identifies the job to the aggregator across resumes, the
+  /// absolute checkpoint path (else the process) by default.
+  void set_aggregator(const std::string &socketPath, int nEvents = 1000, const std::string &jobName = "");
+
+  /// Match reco to truth jets by dR only, without the JetEvalStack, whose
+  /// tower evaluation needs the Geant4 hits (not there with FastCalorimeter)
+  void set_eval_matching(bool enable) { evalMatching = enable; }
+
+  /// Reco and truth jet collections to analyze, the central chain by default;
+  /// the stitched ones (JetRegions.h) cover the full acceptance
+  void set_jet_nodes(const std::string &reco, const std::string &truth) { recoJetNode = reco; truthJetNode = truth; }
+
+  /// Nodes process_event reads, for pruning everything else from the macro
+  /// (PrunePipeline in macro/PipelinePruning.C)
+  std::vector<std::string> required_nodes() const;
+
  private:
  TFile *outfile;
  TTree *recoJetTree;
  JetEvalStack *jetEvalStack = nullptr;
-
- // Jet variables
- double recoPt, recoEnergy;
- double truthPt, truthEnergy;
- double dR; // For jet matching
+ bool evalMatching = true;
+ std::string recoJetNode = JetRegions::kCentralTowerJets;
+ std::string truthJetNode = JetRegions::kCentralTruthJets;
+
+ // Jet variables, the entry of recoJetTree being filled
+ RecoJetRow jetRow;
+
+ // Jets of the current event; truthCandidates[i] is truth jet i of jetEvent
+ JetEvent jetEvent;
+ std::vector<const Jet *> truthCandidates;
+ int AddTruthJet(const Jet *truthJet);
+ int eventCount = 0;
+ JetEventWriter *recorder = nullptr;
+
+ // Checkpoints, see set_checkpoint
+ void WriteCheckpoint();
+ std::string checkpointFile;
+ int checkpointEvents = 0;
+ double checkpointMinutes = 0;
+ std::chrono::steady_clock::time_point lastCheckpoint;
+ int eventsProcessed = 0;   // process_event calls, including resumed ones
+ int checkpointedEvents = 0;
+ Long64_t checkpointedEntries = 0;  // of recoJetTree, in the chunks
+ int checkpointChunks = 0;
+ std::string CheckpointChunk(int chunk) const { return checkpointFile + "." + std::to_string(chunk); }
+
+ // Early stopping, see set_convergence
+ ConvergenceMonitor<JetTruthEnergyAxis> *convergence = nullptr;
+
+ // Live aggregation, see set_aggregator
+ void PushAggregator();
+ JetAggregatorClient *aggregator = nullptr;
+ int aggregatorEvents = 0;
+ int aggregatedEvents = 0;
+ // filled since the last push even without an aggregator, a resumed job
+ // pushes what its crashed run did not
+ FixedHist<JetResponseBinning> aggregatorDelta;
+
+ // truth energy vs (reco - truth) / truth, written as a TH2D in End
+ FixedHist<JetResponseBinning> responseHist;
 
 };
 
@@ -0,0 +1,199 @@
+// Tell emacs that this is a C++ source
+//  -*- C++ -*-.
+#ifndef JETEVENTRECORD_H
+#define JETEVENTRECORD_H
+
+// Per event jet kinematics as seen by JetEnergyResolution, and a flat binary
+// file to record them in a Fun4All job and replay them without one
+// (bench/jetReplay.cc).  No ROOT or Fun4All dependencies.
+//
+// File layout, native byte order: the 8 byte magic "JETREC01", then per event
+//   int32 id, float jetParameter, uint32 nReco, uint32 nTruth,
+//   float recoPt[nReco], recoE[nReco], recoEta[nReco], recoPhi[nReco],
+//   int32 evalMatch[nReco],
+//   float truthPt[nTruth], truthE[nTruth], truthEta[nTruth], truthPhi[nTruth]
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+const char kJetEventMagic[8] = {'J', 'E', 'T', 'R', 'E', 'C', '0', '1'};
+
+struct JetEvent
+{
+  int32_t id = 0;
+  float jetParameter = 0;  ///< R of the reco jets, the dR cut of the fallback matching
+
+  std::vector<float> recoPt, recoE, recoEta, recoPhi;
+  std::vector<int32_t> evalMatch;  ///< truth index of max_truth_jet_by_energy, -1 if none
+
+  std::vector<float> truthPt, truthE, truthEta, truthPhi;
+
+  void Clear()
+  {
+    recoPt.clear();
+    recoE.clear();
+    recoEta.clear();
+    recoPhi.clear();
+    evalMatch.clear();
+    truthPt.clear();
+    truthE.clear();
+    truthEta.clear();
+    truthPhi.clear();
+  }
+
+  void AddReco(float pt, float e, float eta, float phi, int32_t match)
+  {
+    recoPt.push_back(pt);
+    recoE.push_back(e);
+    recoEta.push_back(eta);
+    recoPhi.push_back(phi);
+    evalMatch.push_back(match);
+  }
+
+  /// Returns the index of the new truth jet
+  int32_t AddTruth(float pt, float e, float eta, float phi)
+  {
+    truthPt.push_back(pt);
+    truthE.push_back(e);
+    truthEta.push_back(eta);
+    truthPhi.push_back(phi);
+    return static_cast<int32_t>(truthPt.size()) - 1;
+  }
+
+  std::size_t NReco() const { return recoPt.size(); }
+  std::size_t NTruth() const { return truthPt.size(); }
+};
+
+class JetEventWriter
+{
+ public:
+  explicit JetEventWriter(const std::string &path)
+  {
+    file = std::fopen(path.c_str(), "wb");
+    if (file)
+    {
+      std::fwrite(kJetEventMagic, 1, sizeof(kJetEventMagic), file);
+    }
+  }
+
+  ~JetEventWriter()
+  {
+    if (file)
+    {
+      std::fclose(file);
+    }
+  }
+
+  bool IsOpen() const { return file != nullptr; }
+
+  void Write(const JetEvent &event)
+  {
+    uint32_t nReco = event.NReco();
+    uint32_t nTruth = event.NTruth();
+    std::fwrite(&event.id, sizeof(event.id), 1, file);
+    std::fwrite(&event.jetParameter, sizeof(event.jetParameter), 1, file);
+    std::fwrite(&nReco, sizeof(nReco), 1, file);
+    std::fwrite(&nTruth, sizeof(nTruth), 1, file);
+    WriteColumn(event.recoPt);
+    WriteColumn(event.recoE);
+    WriteColumn(event.recoEta);
+    WriteColumn(event.recoPhi);
+    WriteColumn(event.evalMatch);
+    WriteColumn(event.truthPt);
+    WriteColumn(event.truthE);
+    WriteColumn(event.truthEta);
+    WriteColumn(event.truthPhi);
+  }
+
+ private:
+  template <class T>
+  void WriteColumn(const std::vector<T> &column)
+  {
+    if (!column.empty())
+    {
+      std::fwrite(column.data(), sizeof(T), column.size(), file);
+    }
+  }
+
+  FILE *file = nullptr;
+};
+
+class JetEventReader
+{
+ public:
+  explicit JetEventReader(const std::string &path)
+  {
+    file = std::fopen(path.c_str(), "rb");
+    char magic[sizeof(kJetEventMagic)];
+    if (file && (std::fseek(file, 0, SEEK_END) != 0 || (size = std::ftell(file)) < 0 || std::fseek(file, 0, SEEK_SET) != 0 ||
+                 std::fread(magic, 1, sizeof(magic), file) != sizeof(magic) ||
+                 std::memcmp(magic, kJetEventMagic, sizeof(magic)) != 0))
+    {
+      std::fclose(file);
+      file = nullptr;
+    }
+  }
+
+  ~JetEventReader()
+  {
+    if (file)
+    {
+      std::fclose(file);
+    }
+  }
+
+  /// False if the file could not be opened or is not a jet event record
+  bool IsOpen() const { return file != nullptr; }
+
+  /// Read the next event, false at the end of the file or on a truncated or
+  /// corrupt event (then Damaged)
+  bool Next(JetEvent &event)
+  {
+    uint32_t nReco, nTruth;
+    if (!file || std::fread(&event.id, sizeof(event.id), 1, file) != 1)
+    {
+      return false;
+    }
+    if (std::fread(&event.jetParameter, sizeof(event.jetParameter), 1, file) != 1 ||
+        std::fread(&nReco, sizeof(nReco), 1, file) != 1 ||
+        std::fread(&nTruth, sizeof(nTruth), 1, file) != 1)
+    {
+      damaged = true;
+      return false;
+    }
+    // the counts must fit in the rest of the file before anything is allocated
+    long position = std::ftell(file);
+    uint64_t eventSize = uint64_t(nReco) * (4 * sizeof(float) + sizeof(int32_t)) + uint64_t(nTruth) * 4 * sizeof(float);
+    if (position < 0 || eventSize > static_cast<uint64_t>(size - position))
+    {
+      damaged = true;
+      return false;
+    }
+    damaged = !(ReadColumn(event.recoPt, nReco) && ReadColumn(event.recoE, nReco) &&
+                ReadColumn(event.recoEta, nReco) && ReadColumn(event.recoPhi, nReco) &&
+                ReadColumn(event.evalMatch, nReco) &&
+                ReadColumn(event.truthPt, nTruth) && ReadColumn(event.truthE, nTruth) &&
+                ReadColumn(event.truthEta, nTruth) && ReadColumn(event.truthPhi, nTruth));
+    return !damaged;
+  }
+
+  /// True once Next stopped at a truncated or corrupt event rather than the end
+  bool Damaged() const { return damaged; }
+
+ private:
+  template <class T>
+  bool ReadColumn(std::vector<T> &column, uint32_t n)
+  {
+    column.resize(n);
+    return n == 0 || std::fread(column.data(), sizeof(T), n, file) == n;
+  }
+
+  FILE *file = nullptr;
+  long size = 0;
+  bool damaged = false;
+};
+
+#endif  // JETEVENTRECORD_H
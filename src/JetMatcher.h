@@ -0,0 +1,107 @@
+// Tell emacs that this is a C++ source
+//  -*- C++ -*-.
+#ifndef JETMATCHER_H
+#define JETMATCHER_H
+
+// Matching policies shared by the module, the replay driver and the macros.
+// Each policy is a small value type; code that matches takes the policy as a
+// template parameter, so the choice between them (and between phi wrap
+// policies, see JetMatching.h) is made at compile time and the inner loop has
+// no runtime switch.
+//
+//   DeltaRCut  closest truth jet with dR < maxDR (the module's fallback with
+//              maxDR = get_par(), the macros' r)
+//   EnergyMax  the eval's max_truth_jet_by_energy, stored in JetEvent::evalMatch,
+//              above a truth pt cut
+//   Hybrid     EnergyMax, DeltaRCut when the eval has no match (the module)
+//
+// Event policies provide
+//   int Match(const JetEvent &event, std::size_t reco, float &dR) const
+// returning the truth jet index or -1, with dR the match distance or
+// kEvalMatch.  DeltaRCut also decides on pre-paired ntuple rows.
+
+#include "JetEventRecord.h"
+#include "JetMatching.h"
+
+namespace JetMatching
+{
+  /// dR reported for matches taken from the eval
+  constexpr float kEvalMatch = -100;
+
+  template <class Wrap = CompareWrap>
+  class DeltaRCut
+  {
+   public:
+    explicit DeltaRCut(float cut)
+      : maxDR(cut)
+      , maxDR2(cut * cut)
+    {
+    }
+
+    float MaxDR() const { return maxDR; }
+
+    int Match(const JetEvent &event, std::size_t reco, float &dR) const
+    {
+      return ClosestMatch<Wrap>(event.recoEta[reco], event.recoPhi[reco], event.truthEta.data(), event.truthPhi.data(),
+                                event.NTruth(), maxDR, dR);
+    }
+
+    /// dR^2 of an ntuple row, see PairDistance2
+    float Distance2(float *pos) const { return PairDistance2<Wrap>(pos); }
+
+    /// Whether a pair at dR^2 is matched, false for kNoMatch
+    bool Accept(float dR2) const { return dR2 < maxDR2; }
+
+    bool Accept(float *pos) const { return Accept(Distance2(pos)); }
+
+   private:
+    float maxDR;
+    float maxDR2;
+  };
+
+  class EnergyMax
+  {
+   public:
+    explicit EnergyMax(float ptMin)
+      : truthPtMin(ptMin)
+    {
+    }
+
+    int Match(const JetEvent &event, std::size_t reco, float &dR) const
+    {
+      int truth = event.evalMatch[reco];
+      dR = truth < 0 ? kNoMatch : kEvalMatch;
+      return truth < 0 || event.truthPt[truth] < truthPtMin ? -1 : truth;
+    }
+
+   private:
+    float truthPtMin;
+  };
+
+  template <class Wrap = CompareWrap>
+  class Hybrid
+  {
+   public:
+    Hybrid(float truthPtMin, float maxDR)
+      : energyMax(truthPtMin)
+      , deltaR(maxDR)
+    {
+    }
+
+    int Match(const JetEvent &event, std::size_t reco, float &dR) const
+    {
+      // an eval match below the pt cut rejects the jet, it does not fall back
+      if (event.evalMatch[reco] >= 0)
+      {
+        return energyMax.Match(event, reco, dR);
+      }
+      return deltaR.Match(event, reco, dR);
+    }
+
+   private:
+    EnergyMax energyMax;
+    DeltaRCut<Wrap> deltaR;
+  };
+}  // namespace JetMatching
+
+#endif  // JETMATCHER_H
@@ -0,0 +1,122 @@
+// Tell emacs that this is a C++ source
+//  -*- C++ -*-.
+#ifndef JETMATCHING_H
+#define JETMATCHING_H
+
+// Jet matching kernels shared by the module, the analysis macros and the
+// matching micro-benchmark (bench/matchingBenchmark.cc).  Plain floats only,
+// no ROOT or Fun4All, so they can be built and timed on their own.
+
+#include <cmath>
+#include <cstddef>
+
+namespace JetMatching
+{
+  constexpr float kPi = 3.14159265358979f;
+  constexpr float kTwoPi = 2 * kPi;
+
+  /// Distance returned when nothing is matched
+  constexpr float kNoMatch = 9999;
+
+  /// Wrap a phi difference of two angles in [-pi, pi] into [-pi, pi]
+  inline float WrapPhi(float dPhi)
+  {
+    if (dPhi > kPi)
+    {
+      dPhi -= kTwoPi;
+    }
+    else if (dPhi < -kPi)
+    {
+      dPhi += kTwoPi;
+    }
+    return dPhi;
+  }
+
+  /// Phi wrap policies of the kernels below, picked at compile time.
+  /// CompareWrap is WrapPhi; TableWrap looks the 2 pi offset up by the sign of
+  /// the overflow, which leaves no branch in the inner loops.
+  struct CompareWrap
+  {
+    static float Wrap(float dPhi) { return WrapPhi(dPhi); }
+  };
+
+  struct TableWrap
+  {
+    static float Wrap(float dPhi)
+    {
+      static const float offset[3] = {kTwoPi, 0, -kTwoPi};
+      return dPhi + offset[(dPhi > kPi) - (dPhi < -kPi) + 1];
+    }
+  };
+
+  /// dEta^2 + dPhi^2 with phi wrapped
+  template <class Wrap = CompareWrap>
+  inline float DeltaR2(float eta1, float phi1, float eta2, float phi2)
+  {
+    float dEta = eta1 - eta2;
+    float dPhi = Wrap::Wrap(phi1 - phi2);
+    return dEta * dEta + dPhi * dPhi;
+  }
+
+  /// dR^2 of one ntuple row pos = [truthEta, truthPhi, recoEta, recoPhi], or
+  /// kNoMatch if any is NaN.  recoPhi is moved onto the same side of the wrap
+  /// as truthPhi so the two can be histogrammed against each other.
+  template <class Wrap = CompareWrap>
+  inline float PairDistance2(float *pos)
+  {
+    for (int i = 0; i < 4; i++)
+    {
+      if (std::isnan(pos[i]))
+      {
+        return kNoMatch;
+      }
+    }
+    float dPhi = pos[1] - pos[3];
+    float wrappedPhi = Wrap::Wrap(dPhi);
+    pos[3] += dPhi - wrappedPhi;
+    float dEta = pos[0] - pos[2];
+    return dEta * dEta + wrappedPhi * wrappedPhi;
+  }
+
+  /// PairDistance2 over n rows stored as columns, for memory mapped caches.
+  /// Writes dR^2 (kNoMatch for rows with a NaN) and the wrap adjusted reco phi.
+  /// Branch free, so the compiler can vectorize it.
+  template <class Wrap = CompareWrap>
+  inline void PairDistance2Batch(const float *truthEta, const float *truthPhi, const float *recoEta, const float *recoPhi,
+                                 std::size_t n, float *dR2, float *wrappedRecoPhi)
+  {
+    for (std::size_t i = 0; i < n; i++)
+    {
+      float dPhi = truthPhi[i] - recoPhi[i];
+      float wrappedPhi = Wrap::Wrap(dPhi);
+      float dEta = truthEta[i] - recoEta[i];
+      bool isNaN = std::isnan(truthEta[i]) || std::isnan(truthPhi[i]) || std::isnan(recoEta[i]) || std::isnan(recoPhi[i]);
+      dR2[i] = isNaN ? kNoMatch : dEta * dEta + wrappedPhi * wrappedPhi;
+      wrappedRecoPhi[i] = isNaN ? recoPhi[i] : recoPhi[i] + (dPhi - wrappedPhi);
+    }
+  }
+
+  /// Index of the candidate closest to (eta, phi) with dR < maxDR, or -1.
+  /// Candidates are passed as separate eta and phi arrays so the scan is a
+  /// straight pass over contiguous memory; dR is set to the match distance or
+  /// kNoMatch.
+  template <class Wrap = CompareWrap>
+  inline int ClosestMatch(float eta, float phi, const float *etas, const float *phis, std::size_t n, float maxDR, float &dR)
+  {
+    float best = maxDR * maxDR;
+    int index = -1;
+    for (std::size_t i = 0; i < n; i++)
+    {
+      float dR2 = DeltaR2<Wrap>(eta, phi, etas[i], phis[i]);
+      if (dR2 < best)
+      {
+        best = dR2;
+        index = static_cast<int>(i);
+      }
+    }
+    dR = index < 0 ? kNoMatch : std::sqrt(best);
+    return index;
+  }
+}  // namespace JetMatching
+
+#endif  // JETMATCHING_H
@@ -0,0 +1,53 @@
+// Tell emacs that this is a C++ source
+//  -*- C++ -*-.
+#ifndef JETREGIONS_H
+#define JETREGIONS_H
+
+// Central and forward jet chains and their stitched full acceptance
+// collection.  JetStitcher takes the central chain's jets below
+// kForwardEtaMin and the forward chain's above, so the region of a stitched
+// jet, which chain reconstructed it, follows from its eta with StitchRegion.
+// No ROOT or Fun4All.
+
+#include <string>
+
+namespace JetRegions
+{
+  enum Region
+  {
+    kUnknown = -1,  // a collection of neither chain
+    kCentral = 0,
+    kForward = 1
+  };
+
+  /// Jet eta from which the stitched collection takes the forward chain
+  /// (FEMC + FHCAL) instead of the central one (CEMC + HCALs)
+  constexpr float kForwardEtaMin = 1.3f;
+
+  inline Region StitchRegion(float eta)
+  {
+    return eta >= kForwardEtaMin ? kForward : kCentral;
+  }
+
+  /// Node names of the chains, r = 0.4
+  constexpr const char *kCentralTowerJets = "AntiKt_Tower_r04";
+  constexpr const char *kCentralTruthJets = "AntiKt_Truth_r04";
+  constexpr const char *kForwardTowerJets = "AntiKt_Tower_Fwd_r04";
+  constexpr const char *kForwardTruthJets = "AntiKt_Truth_Fwd_r04";
+  constexpr const char *kStitchedTowerJets = "AntiKt_Tower_Full_r04";
+  constexpr const char *kStitchedTruthJets = "AntiKt_Truth_Full_r04";
+
+  /// Region of the jets of the reco collection recoNode: per jet with
+  /// StitchRegion for the stitched one, else the same for every jet
+  inline bool IsStitched(const std::string &recoNode)
+  {
+    return recoNode == kStitchedTowerJets;
+  }
+
+  inline Region CollectionRegion(const std::string &recoNode)
+  {
+    return recoNode == kCentralTowerJets ? kCentral : recoNode == kForwardTowerJets ? kForward : kUnknown;
+  }
+}
+
+#endif  // JETREGIONS_H
@@ -0,0 +1,130 @@
+// Tell emacs that this is a C++ source
+//  -*- C++ -*-.
+#ifndef JETRESOLUTIONCORE_H
+#define JETRESOLUTIONCORE_H
+
+// Matching and selection of JetEnergyResolution, on a JetEvent instead of the
+// node tree, so the module and the replay driver (bench/jetReplay.cc) run the
+// same code.  By default every reco jet takes the eval's max_truth_jet_by_energy,
+// or if the eval has none the closest truth jet with dR < jetParameter
+// (JetMatching::Hybrid); other policies from JetMatcher.h can be passed in.
+
+#include "FixedHistogram.h"
+#include "JetEventRecord.h"
+#include "JetMatcher.h"
+
+#include <TTree.h>
+
+// truth energy vs (reco - truth) / truth, written as a TH2D
+typedef UniformAxis<80, 0, 80> JetTruthEnergyAxis;
+typedef Binning2D<JetTruthEnergyAxis, UniformAxis<80, -2, 2>> JetResponseBinning;
+
+struct MatchedJet
+{
+  double recoPt, recoEnergy;
+  double truthPt, truthEnergy;
+  double recoEta, truthEta;
+  double dR;  ///< JetMatching::kEvalMatch for eval matches
+};
+
+/// One RecoJetTree entry
+struct RecoJetRow
+{
+  double recoPt, recoEnergy;
+  double truthPt, truthEnergy;
+  double dR;
+  double recoEta, truthEta;
+  int region = 0;            ///< JetRegions::Region, the chain of the reco jet, kUnknown if not known
+  double weight = 1;         ///< event weight of a TruthJetPreselection
+  bool preselected = true;   ///< false for an event the preselection kept by its prescale
+
+  void SetJet(const MatchedJet &jet)
+  {
+    recoPt = jet.recoPt;
+    recoEnergy = jet.recoEnergy;
+    truthPt = jet.truthPt;
+    truthEnergy = jet.truthEnergy;
+    dR = jet.dR;
+    recoEta = jet.recoEta;
+    truthEta = jet.truthEta;
+  }
+};
+
+namespace JetResolutionCore
+{
+  /// Eval matched truth jets below this pt are skipped
+  const float kTruthPtMin = 5;
+
+  /// Policy of the module: eval match above kTruthPtMin, dR < jetParameter fallback
+  typedef JetMatching::Hybrid<JetMatching::TableWrap> ModulePolicy;
+
+  /// Calls fill(const MatchedJet &) for every reco jet of event policy matches
+  template <class Policy, class Fill>
+  void MatchEvent(const JetEvent &event, const Policy &policy, Fill fill)
+  {
+    MatchedJet jet;
+    for (std::size_t reco = 0; reco < event.NReco(); reco++)
+    {
+      float dR;
+      int truth = policy.Match(event, reco, dR);
+      if (truth < 0)
+      {
+        continue;
+      }
+      jet.recoPt = event.recoPt[reco];
+      jet.recoEnergy = event.recoE[reco];
+      jet.truthPt = event.truthPt[truth];
+      jet.truthEnergy = event.truthE[truth];
+      jet.recoEta = event.recoEta[reco];
+      jet.truthEta = event.truthEta[truth];
+      jet.dR = dR;
+      fill(jet);
+    }
+  }
+
+  /// MatchEvent with the module's policy
+  template <class Fill>
+  void MatchEvent(const JetEvent &event, Fill fill)
+  {
+    MatchEvent(event, ModulePolicy(kTruthPtMin, event.jetParameter), fill);
+  }
+
+  /// The response histogram fill shared by the module and the replay, weight
+  /// is the event weight of a preselection
+  inline void FillResponse(FixedHist<JetResponseBinning> &response, const MatchedJet &jet, double weight = 1)
+  {
+    response.FillWeighted(weight, jet.truthEnergy, (jet.recoEnergy - jet.truthEnergy) / jet.truthEnergy);
+  }
+
+  /// The RecoJetTree schema: bind(name, address, leaflist) for every branch
+  template <class Bind>
+  void RecoJetBranches(RecoJetRow &row, Bind bind)
+  {
+    bind("recoPt", &row.recoPt, "recoPt/D");
+    bind("recoEnergy", &row.recoEnergy, "recoEnergy/D");
+    bind("truthPt", &row.truthPt, "truthPt/D");
+    bind("truthEnergy", &row.truthEnergy, "truthEnergy/D");
+    bind("dR", &row.dR, "dR/D");
+    bind("recoEta", &row.recoEta, "recoEta/D");
+    bind("truthEta", &row.truthEta, "truthEta/D");
+    bind("region", &row.region, "region/I");
+    bind("weight", &row.weight, "weight/D");
+    bind("preselected", &row.preselected, "preselected/O");
+  }
+
+  /// A new RecoJetTree filled from row
+  inline TTree *BookRecoJetTree(RecoJetRow &row)
+  {
+    TTree *tree = new TTree("RecoJetTree", "A tree containing reconstructed jets");
+    RecoJetBranches(row, [tree](const char *name, auto *address, const char *leaves) { tree->Branch(name, address, leaves); });
+    return tree;
+  }
+
+  /// Read the entries of a RecoJetTree into row
+  inline void ReadRecoJetTree(TTree *tree, RecoJetRow &row)
+  {
+    RecoJetBranches(row, [tree](const char *name, auto *address, const char *) { tree->SetBranchAddress(name, address); });
+  }
+}  // namespace JetResolutionCore
+
+#endif  // JETRESOLUTIONCORE_H
@@ -0,0 +1,108 @@
+#include "JetStitcher.h"
+
+#include "JetMatching.h"
+#include "JetRegions.h"
+
+#include <fun4all/Fun4AllReturnCodes.h>
+
+#include <g4jets/Jet.h>
+#include <g4jets/JetMap.h>
+#include <g4jets/JetMapv1.h>
+
+#include <phool/PHCompositeNode.h>
+#include <phool/PHIODataNode.h>
+#include <phool/PHNodeIterator.h>
+#include <phool/getClass.h>
+
+#include <iostream>
+#include <set>
+#include <vector>
+
+//____________________________________________________________________________..
+JetStitcher::JetStitcher(const std::string &name):
+ SubsysReco(name)
+{
+}
+
+//____________________________________________________________________________..
+int JetStitcher::InitRun(PHCompositeNode *topNode)
+{
+  stitched = findNode::getClass<JetMap>(topNode, outputNode);
+  if (stitched) {
+    return Fun4AllReturnCodes::EVENT_OK;
+  }
+  PHNodeIterator iter(topNode);
+  PHCompositeNode *dstNode = dynamic_cast<PHCompositeNode *>(iter.findFirst("PHCompositeNode", "DST"));
+  if (!dstNode) {
+    std::cout << PHWHERE << " no DST node" << std::endl;
+    return Fun4AllReturnCodes::ABORTRUN;
+  }
+  // next to the jets of JetReco
+  PHNodeIterator dstIter(dstNode);
+  PHCompositeNode *algoNode = dynamic_cast<PHCompositeNode *>(dstIter.findFirst("PHCompositeNode", "ANTIKT"));
+  if (!algoNode) {
+    algoNode = new PHCompositeNode("ANTIKT");
+    dstNode->addNode(algoNode);
+  }
+  stitched = new JetMapv1();
+  algoNode->addNode(new PHIODataNode<PHObject>(stitched, outputNode, "PHObject"));
+  return Fun4AllReturnCodes::EVENT_OK;
+}
+
+//____________________________________________________________________________..
+int JetStitcher::process_event(PHCompositeNode *topNode)
+{
+  JetMap *central = findNode::getClass<JetMap>(topNode, centralNode);
+  JetMap *forward = findNode::getClass<JetMap>(topNode, forwardNode);
+  if (!central || !forward) {
+    std::cout << PHWHERE << " no " << centralNode << " or " << forwardNode << std::endl;
+    return Fun4AllReturnCodes::ABORTRUN;
+  }
+  stitched->Reset();
+  stitched->set_par(central->get_par());
+  stitched->set_algo(central->get_algo());
+  std::vector<Jet *> centralJets;
+  std::vector<Jet *> forwardJets;
+  for (JetMap::Iter iter = central->begin(); iter != central->end(); ++iter) {
+    if (JetRegions::StitchRegion(iter->second->get_eta()) == JetRegions::kCentral) {
+      centralJets.push_back(iter->second);
+    }
+  }
+  for (JetMap::Iter iter = forward->begin(); iter != forward->end(); ++iter) {
+    if (JetRegions::StitchRegion(iter->second->get_eta()) == JetRegions::kForward) {
+      forwardJets.push_back(iter->second);
+    }
+  }
+  // a jet found by both chains on either side of the boundary is kept once
+  float maxDR2 = central->get_par() * central->get_par();
+  std::vector<bool> centralDropped(centralJets.size(), false);
+  std::vector<bool> forwardDropped(forwardJets.size(), false);
+  for (size_t i = 0; i < centralJets.size(); i++) {
+    for (size_t j = 0; j < forwardJets.size(); j++) {
+      if (JetMatching::DeltaR2(centralJets[i]->get_eta(), centralJets[i]->get_phi(), forwardJets[j]->get_eta(), forwardJets[j]->get_phi()) < maxDR2) {
+        if (centralJets[i]->get_e() >= forwardJets[j]->get_e()) {
+          forwardDropped[j] = true;
+        }
+        else {
+          centralDropped[i] = true;
+        }
+      }
+    }
+  }
+  for (size_t i = 0; i < centralJets.size(); i++) {
+    if (!centralDropped[i]) {
+      stitched->insert(centralJets[i]->CloneMe());
+    }
+  }
+  for (size_t j = 0; j < forwardJets.size(); j++) {
+    if (!forwardDropped[j]) {
+      stitched->insert(forwardJets[j]->CloneMe());
+    }
+  }
+  for (JetMap *source : {central, forward}) {
+    for (std::set<Jet::SRC>::const_iterator src = source->begin_src(); src != source->end_src(); ++src) {
+      stitched->insert_src(*src);
+    }
+  }
+  return Fun4AllReturnCodes::EVENT_OK;
+}
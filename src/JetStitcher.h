@@ -0,0 +1,44 @@
+// Tell emacs that this is a C++ source
+//  -*- C++ -*-.
+#ifndef JETSTITCHER_H
+#define JETSTITCHER_H
+
+#include <fun4all/SubsysReco.h>
+
+#include <string>
+
+class JetMap;
+class PHCompositeNode;
+
+/// Full acceptance jet collection from the central and forward chains, which
+/// write separate nodes: copies of the central jets below
+/// JetRegions::kForwardEtaMin and of the forward jets above it.  The chains
+/// cluster independently, so a jet on the boundary can come out of both, just
+/// below it from one and just above from the other; of a central and a
+/// forward jet closer than the jet radius only the more energetic is kept.
+/// One stitcher per collection (tower, truth).
+class JetStitcher : public SubsysReco
+{
+ public:
+
+  JetStitcher(const std::string &name = "JetStitcher");
+
+  virtual ~JetStitcher() {}
+
+  int InitRun(PHCompositeNode *topNode) override;
+
+  int process_event(PHCompositeNode *topNode) override;
+
+  void set_inputs(const std::string &central, const std::string &forward) { centralNode = central; forwardNode = forward; }
+
+  void set_output(const std::string &output) { outputNode = output; }
+
+ private:
+ std::string centralNode;
+ std::string forwardNode;
+ std::string outputNode;
+ JetMap *stitched = nullptr;
+
+};
+
+#endif // JETSTITCHER_H
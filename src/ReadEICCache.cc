@@ -0,0 +1,99 @@
+#include "ReadEICCache.h"
+
+#include "EICEventFile.h"
+
+#include <fun4all/Fun4AllReturnCodes.h>
+
+#include <phool/PHCompositeNode.h>
+
+#include <HepMC/GenEvent.h>
+#include <HepMC/GenParticle.h>
+#include <HepMC/GenVertex.h>
+#include <HepMC/SimpleVector.h>
+#include <HepMC/Units.h>
+
+#include <iostream>
+
+//____________________________________________________________________________..
+ReadEICCache::ReadEICCache(const std::string &name):
+ SubsysReco(name)
+{
+}
+
+//____________________________________________________________________________..
+ReadEICCache::~ReadEICCache()
+{
+  delete events;
+}
+
+//____________________________________________________________________________..
+bool ReadEICCache::OpenInputFile(const std::string &filename)
+{
+  delete events;
+  events = new EICEventFile(filename);
+  if (!events->IsOpen()) {
+    std::cout << "Could not open EIC event file " << filename << std::endl;
+    delete events;
+    events = nullptr;
+    return false;
+  }
+  std::cout << "ReadEICCache: " << events->NEvents() << " events in " << filename << std::endl;
+  return true;
+}
+
+//____________________________________________________________________________..
+int ReadEICCache::Init(PHCompositeNode *topNode)
+{
+  if (!events) {
+    std::cout << "ReadEICCache: no input file, call OpenInputFile first" << std::endl;
+    return Fun4AllReturnCodes::ABORTRUN;
+  }
+  return create_node_tree(topNode);
+}
+
+//____________________________________________________________________________..
+int ReadEICCache::process_event(PHCompositeNode *topNode)
+{
+  if (nextEntry >= events->NEvents()) {
+    std::cout << "ReadEICCache: no more events after " << nextEntry << std::endl;
+    return Fun4AllReturnCodes::ABORTRUN;
+  }
+  const EICEventHeader *event = events->Event(nextEntry);
+  if (!event) {
+    std::cout << "ReadEICCache: event " << nextEntry << " is damaged, reconvert the file" << std::endl;
+    return Fun4AllReturnCodes::ABORTRUN;
+  }
+  const EICEventHeader &header = *event;
+  const EICParticle *particles = events->Particles(event);
+  nextEntry++;
+
+  HepMC::GenEvent *genEvent = new HepMC::GenEvent();
+  genEvent->use_units(HepMC::Units::GEV, HepMC::Units::CM);
+  genEvent->set_event_number(header.eventNumber);
+  HepMC::GenVertex *vertex = new HepMC::GenVertex(HepMC::FourVector(0, 0, 0, 0));
+  HepMC::GenParticle *beams[2] = {nullptr, nullptr};
+  for (uint32_t i = 0; i < header.nParticles; i++) {
+    const EICParticle &particle = particles[i];
+    bool beam = i < 2;
+    if (!beam && particle.status != 1) {
+      continue;
+    }
+    HepMC::GenParticle *genParticle = new HepMC::GenParticle(HepMC::FourVector(particle.px, particle.py, particle.pz, particle.e), particle.pid, beam ? 3 : 1);
+    genParticle->set_generated_mass(particle.m);
+    if (beam) {
+      beams[i] = genParticle;
+      vertex->add_particle_in(genParticle);
+    } else {
+      vertex->add_particle_out(genParticle);
+    }
+  }
+  genEvent->add_vertex(vertex);
+  if (beams[0] && beams[1]) {
+    genEvent->set_beam_particles(beams[0], beams[1]);
+  }
+  if (!insert_event(genEvent)) {
+    std::cout << PHWHERE << " could not insert event " << header.eventNumber << std::endl;
+    return Fun4AllReturnCodes::ABORTRUN;
+  }
+  return Fun4AllReturnCodes::EVENT_OK;
+}
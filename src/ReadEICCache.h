@@ -0,0 +1,43 @@
+// Tell emacs that this is a C++ source
+//  -*- C++ -*-.
+#ifndef READEICCACHE_H
+#define READEICCACHE_H
+
+#include <fun4all/SubsysReco.h>
+#include <phhepmc/PHHepMCGenHelper.h>
+
+#include <cstdint>
+#include <string>
+
+class EICEventFile;
+class PHCompositeNode;
+
+/// Generator input from an event file written by macro/convertEIC.cpp
+/// (EICEventFile.h), in place of ReadEICFiles.  Puts the same HepMC event on
+/// the node tree: beams in, status 1 particles out of one vertex, with the
+/// vertex settings of PHHepMCGenHelper.  SetFirstEntry jumps straight to an
+/// event through the file's index.
+class ReadEICCache : public SubsysReco, public PHHepMCGenHelper
+{
+ public:
+
+  ReadEICCache(const std::string &name = "ReadEICCache");
+
+  virtual ~ReadEICCache();
+
+  bool OpenInputFile(const std::string &filename);
+
+  /// First event to read, e.g. the first event of a shard
+  void SetFirstEntry(uint64_t entry) { nextEntry = entry; }
+
+  int Init(PHCompositeNode *topNode) override;
+
+  int process_event(PHCompositeNode *topNode) override;
+
+ private:
+ EICEventFile *events = nullptr;
+ uint64_t nextEntry = 0;
+
+};
+
+#endif // READEICCACHE_H
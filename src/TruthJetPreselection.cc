@@ -0,0 +1,113 @@
+#include "TruthJetPreselection.h"
+
+#include <fun4all/Fun4AllReturnCodes.h>
+
+#include <phool/PHCompositeNode.h>
+#include <phool/PHDataNode.h>
+#include <phool/getClass.h>
+
+#include <phhepmc/PHHepMCGenEvent.h>
+#include <phhepmc/PHHepMCGenEventMap.h>
+
+#include <HepMC/GenEvent.h>
+#include <HepMC/GenParticle.h>
+
+#include <fastjet/ClusterSequence.hh>
+#include <fastjet/JetDefinition.hh>
+#include <fastjet/PseudoJet.hh>
+
+#include <TFile.h>
+#include <TParameter.h>
+
+#include <iostream>
+#include <vector>
+
+//____________________________________________________________________________..
+TruthJetPreselection::TruthJetPreselection(const std::string &name):
+ SubsysReco(name)
+{
+}
+
+//____________________________________________________________________________..
+int TruthJetPreselection::InitRun(PHCompositeNode *topNode)
+{
+  result = findNode::getClass<PreselectionResult>(topNode, kPreselectionResultNode);
+  if (!result) {
+    result = new PreselectionResult();
+    topNode->addNode(new PHDataNode<PreselectionResult>(result, kPreselectionResultNode));
+  }
+  return Fun4AllReturnCodes::EVENT_OK;
+}
+
+//____________________________________________________________________________..
+int TruthJetPreselection::process_event(PHCompositeNode *topNode)
+{
+  PHHepMCGenEventMap *genEventMap = findNode::getClass<PHHepMCGenEventMap>(topNode, "PHHepMCGenEventMap");
+  if (!genEventMap) {
+    std::cout << PHWHERE << " no PHHepMCGenEventMap, register the preselection after the generators" << std::endl;
+    return Fun4AllReturnCodes::ABORTRUN;
+  }
+  eventsSeen++;
+
+  // Final state particles of every generated event (signal and embedded)
+  std::vector<fastjet::PseudoJet> particles;
+  for (PHHepMCGenEventMap::ConstIter iter = genEventMap->begin(); iter != genEventMap->end(); ++iter) {
+    HepMC::GenEvent *genEvent = iter->second->getEvent();
+    if (!genEvent) {
+      continue;
+    }
+    for (HepMC::GenEvent::particle_const_iterator particle = genEvent->particles_begin(); particle != genEvent->particles_end(); ++particle) {
+      if ((*particle)->status() != 1) {
+        continue;
+      }
+      const HepMC::FourVector &momentum = (*particle)->momentum();
+      particles.push_back(fastjet::PseudoJet(momentum.px(), momentum.py(), momentum.pz(), momentum.e()));
+    }
+  }
+
+  fastjet::JetDefinition jetDefinition(fastjet::antikt_algorithm, jetParameter);
+  fastjet::ClusterSequence clusterSequence(particles, jetDefinition);
+  std::vector<fastjet::PseudoJet> jets = clusterSequence.inclusive_jets(ptMin);
+  for (const fastjet::PseudoJet &jet : jets) {
+    if (jet.eta() >= etaMin && jet.eta() < etaMax) {
+      eventsPassed++;
+      result->passed = true;
+      result->weight = 1;
+      return Fun4AllReturnCodes::EVENT_OK;
+    }
+  }
+
+  eventsFailed++;
+  if (prescale > 0 && eventsFailed % prescale == 0) {
+    eventsPrescaled++;
+    result->passed = false;
+    result->weight = prescale;
+    return Fun4AllReturnCodes::EVENT_OK;
+  }
+  return Fun4AllReturnCodes::ABORTEVENT;
+}
+
+//____________________________________________________________________________..
+int TruthJetPreselection::End(PHCompositeNode *topNode)
+{
+  std::cout << "TruthJetPreselection: " << eventsPassed << " of " << eventsSeen << " events passed, " << eventsPrescaled
+            << " failing events kept with prescale " << prescale << std::endl;
+  // Sample normalization: eventsSeen generated events; passing events have
+  // weight 1, prescaled ones weight prescale
+  TFile bookkeeping(bookkeepingFile.c_str(), "RECREATE");
+  if (bookkeeping.IsZombie()) {
+    std::cout << "Could not write preselection bookkeeping to " << bookkeepingFile << std::endl;
+    return Fun4AllReturnCodes::EVENT_OK;
+  }
+  TParameter<Long64_t>("EventsSeen", eventsSeen).Write();
+  TParameter<Long64_t>("EventsPassed", eventsPassed).Write();
+  TParameter<Long64_t>("EventsFailed", eventsFailed).Write();
+  TParameter<Long64_t>("EventsPrescaled", eventsPrescaled).Write();
+  TParameter<int>("Prescale", prescale).Write();
+  TParameter<double>("JetParameter", jetParameter).Write();
+  TParameter<double>("PtMin", ptMin).Write();
+  TParameter<double>("EtaMin", etaMin).Write();
+  TParameter<double>("EtaMax", etaMax).Write();
+  bookkeeping.Close();
+  return Fun4AllReturnCodes::EVENT_OK;
+}
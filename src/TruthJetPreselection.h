@@ -0,0 +1,73 @@
+// Tell emacs that this is a C++ source
+//  -*- C++ -*-.
+#ifndef TRUTHJETPRESELECTION_H
+#define TRUTHJETPRESELECTION_H
+
+#include <fun4all/SubsysReco.h>
+
+#include <string>
+
+class PHCompositeNode;
+
+/// Preselection outcome of the current event, on the node tree as the
+/// PHDataNode kPreselectionResultNode for the modules downstream
+struct PreselectionResult
+{
+  bool passed = true;  // false if failing and kept by the prescale
+  double weight = 1;   // 1 if passed, the prescale otherwise
+};
+
+constexpr const char *kPreselectionResultNode = "PreselectionResult";
+
+/// Generator level jet preselection, registered after the event generators
+/// and before PHG4Reco.  Clusters the final state particles of the HepMC
+/// events with anti-kt and returns ABORTEVENT, so Geant4 never runs, unless a
+/// jet passes the pt and eta cuts.  Failing events can be kept with a
+/// prescale, flagged and weighted in the PreselectionResult node; End writes
+/// the bookkeeping needed to normalize the sample.
+class TruthJetPreselection : public SubsysReco
+{
+ public:
+
+  TruthJetPreselection(const std::string &name = "TruthJetPreselection");
+
+  virtual ~TruthJetPreselection() {}
+
+  int InitRun(PHCompositeNode *topNode) override;
+
+  int process_event(PHCompositeNode *topNode) override;
+
+  int End(PHCompositeNode *topNode) override;
+
+  /// Jet radius, pt threshold and eta acceptance of the preselection.  Keep
+  /// them at or below the analysis cuts, the reconstructed truth jets differ
+  /// slightly from generator level ones.
+  void set_jet_parameter(double r) { jetParameter = r; }
+  void set_pt_min(double pt) { ptMin = pt; }
+  void set_eta_range(double min, double max) { etaMin = min; etaMax = max; }
+
+  /// Keep one in n failing events anyway (0 keeps none), to check the
+  /// preselection; the kept ones count with weight n in the bookkeeping
+  void set_prescale(int n) { prescale = n; }
+
+  /// ROOT file the bookkeeping is written to in End
+  void set_bookkeeping_file(const std::string &filename) { bookkeepingFile = filename; }
+
+ private:
+ double jetParameter = 0.4;
+ double ptMin = 5;
+ double etaMin = -3.5;
+ double etaMax = 3.5;
+ int prescale = 0;
+ std::string bookkeepingFile = "preselection.root";
+ PreselectionResult *result = nullptr;  // owned by the node tree
+
+ // Bookkeeping
+ long eventsSeen = 0;
+ long eventsPassed = 0;
+ long eventsPrescaled = 0;  // failed, kept by the prescale
+ long eventsFailed = 0;
+
+};
+
+#endif // TRUTHJETPRESELECTION_H
@@ -0,0 +1,280 @@
+// Aggregator for concurrent JetEnergyResolution jobs on one node
+//
+// Listens on a Unix socket for the histogram deltas the jobs push (see
+// JetAggregator.h and JetEnergyResolution::set_aggregator), keeps the merged
+// ResponseHist live and rewrites the output every flush interval, so partial
+// results can be looked at while the jobs run.  Exits once the expected number
+// of jobs has finished, or on SIGINT/SIGTERM, after a final write.  Jobs are
+// told apart by their job id, so a job resumed from a checkpoint continues
+// where it was; events it already sent are dropped.  A job whose connection
+// ends without a done message counts as failed once it has not reconnected for
+// resumeSeconds; the exit status is then 1.
+//
+// usage: jetAggregator <socket> <output.root> [jobs] [flushSeconds] [resumeSeconds]
+//        jobs = 0 runs until interrupted
+
+#include "JetAggregator.h"
+#include "JetResolutionCore.h"
+
+#include <TFile.h>
+#include <TParameter.h>
+
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <poll.h>
+
+namespace
+{
+  volatile std::sig_atomic_t stopRequested = 0;
+
+  void RequestStop(int) { stopRequested = 1; }
+
+  struct Job
+  {
+    uint32_t pid = 0;          // of its latest connection, for the log
+    uint64_t eventsEnd = 0;    // one past the last event received
+    bool done = false;
+    bool lost = false;         // disconnected before done
+    std::chrono::steady_clock::time_point lostAt;
+  };
+
+  struct Connection
+  {
+    int fd;
+    std::vector<char> buffer;  // a message may arrive in pieces
+    bool identified = false;
+    uint64_t job = 0;
+  };
+
+  struct Totals
+  {
+    FixedHist<JetResponseBinning> response;
+    uint64_t events = 0;
+    uint64_t deltas = 0;
+    std::map<uint64_t, Job> jobs;
+    int jobsDone = 0;
+    int jobsFailed = 0;
+  };
+
+  // Done jobs, and lost ones that had resumeSeconds to come back
+  void CountJobs(Totals &totals, std::chrono::seconds resumeSeconds)
+  {
+    auto now = std::chrono::steady_clock::now();
+    totals.jobsDone = 0;
+    totals.jobsFailed = 0;
+    for (const auto &job : totals.jobs)
+    {
+      if (job.second.done)
+      {
+        totals.jobsDone++;
+      }
+      else if (job.second.lost && now - job.second.lostAt >= resumeSeconds)
+      {
+        totals.jobsFailed++;
+      }
+    }
+  }
+
+  // Write next to the output and rename, so readers never see a partial file
+  bool WriteOutput(const std::string &path, const Totals &totals)
+  {
+    std::string tmpPath = path + ".tmp";
+    TFile file(tmpPath.c_str(), "RECREATE");
+    if (file.IsZombie())
+    {
+      std::cerr << "Could not write " << tmpPath << std::endl;
+      return false;
+    }
+    totals.response.MakeHist("ResponseHist", ";truth energy;(reco - truth) / truth");  // owned by file
+    TParameter<Long64_t>("EventsProcessed", totals.events).Write();
+    TParameter<int>("JobsDone", totals.jobsDone).Write();
+    TParameter<int>("JobsFailed", totals.jobsFailed).Write();
+    file.Write();
+    file.Close();
+    return std::rename(tmpPath.c_str(), path.c_str()) == 0;
+  }
+
+  // One complete message of a job
+  void HandleMessage(const JetAggregator::MessageHeader &header, const JetAggregator::Cell *cells, Totals &totals)
+  {
+    Job &job = totals.jobs[header.job];
+    job.pid = header.pid;
+    job.lost = false;
+    if (header.type == JetAggregator::kDone)
+    {
+      job.done = true;
+      std::cout << "job " << header.job << " (pid " << header.pid << ") done, " << totals.events << " events so far" << std::endl;
+      return;
+    }
+    if (header.firstEvent < job.eventsEnd)
+    {
+      // sent again by a job resumed from a checkpoint older than its last push
+      std::cout << "job " << header.job << " resent events from " << header.firstEvent << ", dropped" << std::endl;
+      return;
+    }
+    for (uint32_t i = 0; i < header.nCells; i++)
+    {
+      if (cells[i].cell < static_cast<uint32_t>(JetResponseBinning::cells))
+      {
+        totals.response.AddCell(cells[i].cell, cells[i].sumw, cells[i].sumw2);
+      }
+    }
+    totals.response.AddEntries(header.entries);
+    totals.events += header.events;
+    totals.deltas++;
+    job.eventsEnd = header.firstEvent + header.events;
+  }
+
+  // Read what the connection has without blocking and handle every complete
+  // message; false once the connection is finished or broken
+  bool ReadConnection(Connection &connection, Totals &totals)
+  {
+    char bytes[65536];
+    ssize_t received = read(connection.fd, bytes, sizeof(bytes));
+    if (received <= 0)
+    {
+      return false;
+    }
+    connection.buffer.insert(connection.buffer.end(), bytes, bytes + received);
+    std::size_t used = 0;
+    bool open = true;
+    while (open && connection.buffer.size() - used >= sizeof(JetAggregator::MessageHeader))
+    {
+      JetAggregator::MessageHeader header;
+      std::memcpy(&header, connection.buffer.data() + used, sizeof(header));
+      if (header.magic != JetAggregator::kMagic || header.nCells > static_cast<uint32_t>(JetResponseBinning::cells))
+      {
+        return false;
+      }
+      std::size_t size = sizeof(header) + header.nCells * sizeof(JetAggregator::Cell);
+      if (connection.buffer.size() - used < size)
+      {
+        break;
+      }
+      std::vector<JetAggregator::Cell> cells(header.nCells);
+      std::memcpy(cells.data(), connection.buffer.data() + used + sizeof(header), cells.size() * sizeof(JetAggregator::Cell));
+      connection.identified = true;
+      connection.job = header.job;
+      HandleMessage(header, cells.data(), totals);
+      open = header.type != JetAggregator::kDone;
+      used += size;
+    }
+    connection.buffer.erase(connection.buffer.begin(), connection.buffer.begin() + used);
+    return open;
+  }
+
+  void CloseConnection(const Connection &connection, Totals &totals, int resumeSeconds)
+  {
+    close(connection.fd);
+    if (!connection.identified)
+    {
+      return;
+    }
+    Job &job = totals.jobs[connection.job];
+    if (!job.done)
+    {
+      job.lost = true;
+      job.lostAt = std::chrono::steady_clock::now();
+      std::cout << "job " << connection.job << " (pid " << job.pid << ") disconnected before it was done, waiting "
+                << resumeSeconds << " s for it to resume" << std::endl;
+    }
+  }
+}  // namespace
+
+int main(int argc, char **argv)
+{
+  if (argc < 3)
+  {
+    std::cerr << "usage: jetAggregator <socket> <output.root> [jobs] [flushSeconds] [resumeSeconds]" << std::endl;
+    return 1;
+  }
+  std::string socketPath = argv[1];
+  std::string outputPath = argv[2];
+  int expectedJobs = argc > 3 ? std::atoi(argv[3]) : 0;
+  int flushSeconds = argc > 4 ? std::atoi(argv[4]) : 60;
+  int resumeSeconds = argc > 5 ? std::atoi(argv[5]) : 600;
+
+  sockaddr_un address;
+  if (!JetAggregator::SocketAddress(socketPath, address))
+  {
+    std::cerr << "Socket path too long: " << socketPath << std::endl;
+    return 1;
+  }
+  int listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+  unlink(socketPath.c_str());
+  if (listenFd < 0 || bind(listenFd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0 || listen(listenFd, 128) != 0)
+  {
+    std::perror(("Could not listen on " + socketPath).c_str());
+    return 1;
+  }
+  std::signal(SIGINT, RequestStop);
+  std::signal(SIGTERM, RequestStop);
+  std::cout << "aggregating on " << socketPath << " into " << outputPath << std::endl;
+
+  Totals totals;
+  std::vector<Connection> connections;
+  std::vector<pollfd> fds;
+  auto lastFlush = std::chrono::steady_clock::now();
+  uint64_t flushedDeltas = 0;
+  while (!stopRequested && (expectedJobs == 0 || totals.jobsDone + totals.jobsFailed < expectedJobs))
+  {
+    fds.assign(1, {listenFd, POLLIN, 0});
+    for (const Connection &connection : connections)
+    {
+      fds.push_back({connection.fd, POLLIN, 0});
+    }
+    if (poll(fds.data(), fds.size(), 1000) < 0)
+    {
+      continue;  // interrupted by a signal
+    }
+    // one read per readable connection, so a job that sends slowly holds up no other
+    for (std::size_t i = connections.size(); i-- > 0;)
+    {
+      if (fds[i + 1].revents != 0 && !ReadConnection(connections[i], totals))
+      {
+        CloseConnection(connections[i], totals, resumeSeconds);
+        connections.erase(connections.begin() + i);
+      }
+    }
+    if (fds[0].revents & POLLIN)
+    {
+      int client = accept(listenFd, nullptr, nullptr);
+      if (client >= 0)
+      {
+        connections.push_back({client, {}, false, 0});
+      }
+    }
+    CountJobs(totals, std::chrono::seconds(resumeSeconds));
+    if (totals.deltas != flushedDeltas && std::chrono::steady_clock::now() - lastFlush >= std::chrono::seconds(flushSeconds))
+    {
+      WriteOutput(outputPath, totals);
+      flushedDeltas = totals.deltas;
+      lastFlush = std::chrono::steady_clock::now();
+    }
+  }
+
+  for (const Connection &connection : connections)
+  {
+    close(connection.fd);
+  }
+  close(listenFd);
+  unlink(socketPath.c_str());
+  // every job still lost now failed, however recently it went
+  CountJobs(totals, std::chrono::seconds(0));
+  bool written = WriteOutput(outputPath, totals);
+  std::cout << "wrote " << totals.events << " events of " << totals.jobsDone << " jobs to " << outputPath;
+  if (totals.jobsFailed > 0)
+  {
+    std::cout << ", " << totals.jobsFailed << " jobs failed";
+  }
+  std::cout << std::endl;
+  return written && totals.jobsFailed == 0 ? 0 : 1;
+}